@@ -2,6 +2,8 @@
 
 #include <iostream>
 #include <limits>
+#include <algorithm>
+#include <cmath>
 #include <Utils/DebugLayer.h>
 
 ns::Mesh::Mesh(
@@ -10,19 +12,34 @@ ns::Mesh::Mesh(
     const ns::Material& material,
     const ns::MeshConfigInfo& info)
     :
-    numberOfVertices_((info.indexedVertices) ? static_cast<int>(indices.size()) : static_cast<int>(vertices.size())),
+    Mesh(vertices.data(), vertices.size() * sizeof(Vertex), VertexLayout::standard(), indices, material, info)
+{}
+
+ns::Mesh::Mesh(
+    const std::vector<Vertex>& vertices,
+    const std::shared_ptr<const IndexBuffer>& indices,
+    const ns::Material& material,
+    const ns::MeshConfigInfo& info)
+    :
+    Mesh(vertices.data(), vertices.size() * sizeof(Vertex), VertexLayout::standard(), indices, material, info)
+{}
+
+ns::Mesh::Mesh(
+    const void* vertices, size_t verticesSize,
+    const VertexLayout& layout,
+	const std::vector<unsigned int>& indices,
+    const ns::Material& material,
+    const ns::MeshConfigInfo& info)
+    :
+    numberOfVertices_((info.indexedVertices) ? static_cast<int>(indices.size()) : static_cast<int>(verticesSize / layout.stride)),
     material_(material),
-    info_(info)
+    info_(info),
+    layout_(layout)
 {
     //create vertex array
     glGenVertexArrays(1, &vertexArrayObject_);
     glBindVertexArray(vertexArrayObject_);
 
-    //create vertex buffer
-    glGenBuffers(1, &vertexBufferObject_);
-    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject_);
-    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-
     if (info_.indexedVertices) {
         //create index buffer
         glGenBuffers(1, &indexBufferObject_);
@@ -31,25 +48,74 @@ ns::Mesh::Mesh(
         glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * getIndexTypeSize(), getIndices(indices, buf1, buf2), GL_STATIC_DRAW);
     }
 
-    // vertex positions
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, position));
+    setupVertexArray(vertices, verticesSize);
+}
+
+namespace {
+    //the shared index buffer decide of the index type and of the number of indices
+    ns::MeshConfigInfo sharedIndicesInfo(const ns::MeshConfigInfo& info, const ns::IndexBuffer& indices)
+    {
+        ns::MeshConfigInfo ret = info;
+        ret.indexedVertices = true;
+        ret.indexType = indices.type();
+        return ret;
+    }
+}
+
+ns::Mesh::Mesh(
+    const void* vertices, size_t verticesSize,
+    const VertexLayout& layout,
+    const std::shared_ptr<const IndexBuffer>& indices,
+    const ns::Material& material,
+    const ns::MeshConfigInfo& info)
+    :
+    indexBufferObject_(indices->id()),
+    sharedIndices_(indices),
+    numberOfVertices_(indices->count()),
+    material_(material),
+    info_(sharedIndicesInfo(info, *indices)),
+    layout_(layout)
+{
+    //create vertex array
+    glGenVertexArrays(1, &vertexArrayObject_);
+    glBindVertexArray(vertexArrayObject_);
+
+    //the vertex array remember the index buffer
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBufferObject_);
+
+    setupVertexArray(vertices, verticesSize);
+}
+
+ns::Mesh::Mesh(
+    const BufferRange& vertices,
+    const VertexLayout& layout,
+    const std::shared_ptr<const IndexBuffer>& indices,
+    const ns::Material& material,
+    const ns::MeshConfigInfo& info)
+    :
+    Mesh(nullptr, vertices.size, layout, indices, material, info)
+{
+    //gpu to gpu copy, the cpu never touch the vertices
+    glBindBuffer(GL_COPY_READ_BUFFER, vertices.buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, vertexBufferObject_);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, vertices.offset, 0, vertices.size);
 
-    // vertex normals
-    glEnableVertexAttribArray(1);
-    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, normal));
-    
-    // vertex texture coords
-    glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, uv));
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
 
-    // vertex tangents
-    glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
+void ns::Mesh::setupVertexArray(const void* vertices, size_t verticesSize)
+{
+    //create vertex buffer
+    glGenBuffers(1, &vertexBufferObject_);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBufferObject_);
+    glBufferData(GL_ARRAY_BUFFER, verticesSize, vertices, GL_STATIC_DRAW);
 
-    // vertex bitangents
-    glEnableVertexAttribArray(4);
-    glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangent));
+    for (const auto& attribute : layout_.attributes)
+    {
+        glEnableVertexAttribArray(attribute.location);
+        glVertexAttribPointer(attribute.location, attribute.size, attribute.type, attribute.normalized, layout_.stride, (void*)attribute.offset);
+    }
 
     //unbind vertex array 
     glBindVertexArray(0);
@@ -82,7 +148,7 @@ ns::Mesh::~Mesh()
 {
     //destroy buffers and vertex array
 	glDeleteBuffers(1, &vertexBufferObject_);
-	if(info_.indexedVertices) 
+	if(info_.indexedVertices and !sharedIndices_) 
         glDeleteBuffers(1, &indexBufferObject_);
 	glDeleteBuffers(1, &bonesBufferObject_);
 	glDeleteVertexArrays(1, &vertexArrayObject_);
@@ -95,6 +161,9 @@ void ns::Mesh::draw(const Shader& shader) const
 
     material_.bind(shader);
     shader.set("computeBitangents", !info_.hasBitangents);
+    shader.set("compactVertices", layout_.encoding == VertexLayout::Encoding::terrain);
+    if (layout_.encoding == VertexLayout::Encoding::terrain)
+        shader.set("gridSpacing", layout_.gridSpacing);
 
     glBindVertexArray(vertexArrayObject_);
 
@@ -105,6 +174,25 @@ void ns::Mesh::draw(const Shader& shader) const
         glDrawArrays(info_.primitive, 0, numberOfVertices_);
 }
 
+void ns::Mesh::setIndices(const std::shared_ptr<const IndexBuffer>& indices)
+{
+#   ifndef NDEBUG
+    _STL_ASSERT(sharedIndices_, "only the meshes with a shared index buffer can change it");
+    _STL_ASSERT(indices->type() == info_.indexType, "the new index buffer must have the same index type");
+#   endif // !NDEBUG
+
+    if (indices == sharedIndices_) return;
+
+    //the vertex array remember the index buffer
+    glBindVertexArray(vertexArrayObject_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indices->id());
+    glBindVertexArray(0);
+
+    indexBufferObject_ = indices->id();
+    sharedIndices_ = indices;
+    numberOfVertices_ = indices->count();
+}
+
 const void* ns::Mesh::getIndices(const std::vector<unsigned int>& indices,
     std::vector<unsigned char>& indicesBytes,
     std::vector<unsigned short>& indicesShorts
@@ -192,3 +280,111 @@ void ns::Vertex::genBitangent()
 
     bitangent = normalize(cross(normal, tangent));
 }
+
+ns::VertexLayout ns::VertexLayout::standard()
+{
+    VertexLayout ret;
+    ret.stride = sizeof(Vertex);
+    ret.attributes = {
+        { 0, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position) },
+        { 1, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal) },
+        { 2, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, uv) },
+        { 3, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, tangent) },
+        { 4, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, bitangent) }
+    };
+    return ret;
+}
+
+ns::VertexLayout ns::VertexLayout::terrain(const glm::vec2& gridSpacing)
+{
+    VertexLayout ret;
+    ret.stride = sizeof(TerrainVertex);
+    ret.attributes = {
+        { 7, 2, GL_UNSIGNED_SHORT, GL_FALSE, offsetof(TerrainVertex, x) },     //grid indices converted to float
+        { 8, 1, GL_FLOAT, GL_FALSE, offsetof(TerrainVertex, height) },
+        { 9, 2, GL_SHORT, GL_TRUE, offsetof(TerrainVertex, normal) }           //octahedral normal in [-1, 1]
+    };
+    ret.encoding = Encoding::terrain;
+    ret.gridSpacing = gridSpacing;
+    return ret;
+}
+
+void ns::TerrainVertex::setNormal(const glm::vec3& n)
+{
+    //project the normal on the octahedron and unfold its bottom half (the y axis is the center of the map)
+    const float sum = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+    float u = (sum > 0) ? n.x / sum : 0.f;
+    float v = (sum > 0) ? n.z / sum : 0.f;
+
+    if (n.y < 0) {
+        const float foldedU = (1.f - std::abs(v)) * ((u >= 0) ? 1.f : -1.f);
+        const float foldedV = (1.f - std::abs(u)) * ((v >= 0) ? 1.f : -1.f);
+        u = foldedU;
+        v = foldedV;
+    }
+
+    normal[0] = static_cast<int16_t>(std::round(std::clamp(u, -1.f, 1.f) * 32767.f));
+    normal[1] = static_cast<int16_t>(std::round(std::clamp(v, -1.f, 1.f) * 32767.f));
+}
+
+glm::vec3 ns::TerrainVertex::getNormal() const
+{
+    const float u = std::max(normal[0] / 32767.f, -1.f);
+    const float v = std::max(normal[1] / 32767.f, -1.f);
+
+    glm::vec3 ret(u, 1.f - std::abs(u) - std::abs(v), v);
+    if (ret.y < 0) {
+        ret.x = (1.f - std::abs(v)) * ((u >= 0) ? 1.f : -1.f);
+        ret.z = (1.f - std::abs(u)) * ((v >= 0) ? 1.f : -1.f);
+    }
+
+    return glm::normalize(ret);
+}
+
+ns::IndexBuffer::IndexBuffer(const std::vector<unsigned int>& indices)
+    :
+    count_(static_cast<int>(indices.size())),
+    type_(GL_UNSIGNED_INT)
+{
+    unsigned int maximum = 0;
+    for (const auto index : indices)
+        maximum = std::max(maximum, index);
+
+    //make sure that no vertex array record this binding
+    glBindVertexArray(0);
+
+    glGenBuffers(1, &bufferObject_);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, bufferObject_);
+
+    //use 16 bits indices when it is possible
+    if (maximum <= std::numeric_limits<unsigned short>::max()) {
+        type_ = GL_UNSIGNED_SHORT;
+        const std::vector<unsigned short> shorts(indices.begin(), indices.end());
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, shorts.size() * sizeof(unsigned short), shorts.data(), GL_STATIC_DRAW);
+    }
+    else {
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
+    }
+
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}
+
+ns::IndexBuffer::~IndexBuffer()
+{
+    glDeleteBuffers(1, &bufferObject_);
+}
+
+unsigned ns::IndexBuffer::id() const
+{
+    return bufferObject_;
+}
+
+int ns::IndexBuffer::count() const
+{
+    return count_;
+}
+
+GLuint ns::IndexBuffer::type() const
+{
+    return type_;
+}
@@ -1,6 +1,8 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <vector>
+#include <memory>
+#include <cstdint>
 
 //ns
 #include "Texture.h"
@@ -90,6 +92,78 @@ namespace ns {
 		glm::ivec4 ids;
 		glm::vec4 weights;
 	};
+	/**
+	 * @brief 12 bytes vertex of the meshes that are built on a regular grid (like the terrain chunks).
+	 * x and z are the grid indices of the vertex (the distance between two vertices is given by VertexLayout::gridSpacing)
+	 * and the normal is octahedral encoded in two signed normalized 16 bits values
+	 */
+	struct TerrainVertex {
+		TerrainVertex(uint16_t x = 0, uint16_t z = 0, float height = 0.f, const glm::vec3& normal = glm::vec3(0, 1, 0)) :
+			x(x),
+			z(z),
+			height(height)
+		{
+			setNormal(normal);
+		}
+		/**
+		 * @brief encode a normal (it doesn't need to be normalized)
+		 * \param normal
+		 */
+		void setNormal(const glm::vec3& normal);
+		/**
+		 * @brief decode the normal
+		 * \return a normalized vector
+		 */
+		glm::vec3 getNormal() const;
+
+		uint16_t x;
+		uint16_t z;
+		float height;
+		int16_t normal[2];
+	};
+	/**
+	 * @brief describe one attribute of a vertex format (see glVertexAttribPointer)
+	 */
+	struct VertexAttribute {
+		GLuint location;
+		GLint size;
+		GLenum type;
+		GLboolean normalized;
+		size_t offset;
+	};
+	/**
+	 * @brief describe how the vertices of a mesh are stored so the mesh can create its vertex array
+	 */
+	struct VertexLayout {
+		//tell the shaders how to read the vertices
+		enum class Encoding {
+			standard,	//ns::Vertex
+			terrain		//ns::TerrainVertex
+		};
+
+		GLsizei stride = 0;
+		std::vector<VertexAttribute> attributes;
+		Encoding encoding = Encoding::standard;
+		glm::vec2 gridSpacing = glm::vec2(1);	//distance between two grid indices for the terrain encoding
+
+		/**
+		 * @brief layout of ns::Vertex (locations 0 to 4)
+		 */
+		static VertexLayout standard();
+		/**
+		 * @brief layout of ns::TerrainVertex (locations 7 to 9)
+		 * \param gridSpacing distance between two vertices of the grid in x and z
+		 */
+		static VertexLayout terrain(const glm::vec2& gridSpacing);
+	};
+	/**
+	 * @brief part of a gpu buffer (a staging buffer for example)
+	 */
+	struct BufferRange {
+		GLuint buffer;
+		size_t offset;		//in bytes
+		size_t size;		//in bytes
+	};
 	/**
 	 * @brief mesh configuration struct (this is used in the Mesh constructor)
 	 */
@@ -102,6 +176,35 @@ namespace ns {
 		bool hasAnimations = false;
 		bool indexedVertices = true;
 	};
+	/**
+	 * @brief index buffer that can be used by several meshes which have the same topology,
+	 * the smallest index type that can store all the indices is used
+	 */
+	class IndexBuffer
+	{
+	public:
+		/**
+		 * @brief upload the indices in a GL_ELEMENT_ARRAY_BUFFER (need an opengl context)
+		 * \param indices
+		 */
+		IndexBuffer(const std::vector<unsigned int>& indices);
+		/**
+		 * @brief free the buffer
+		 */
+		~IndexBuffer();
+
+		IndexBuffer(const IndexBuffer&) = delete;
+		IndexBuffer& operator=(const IndexBuffer&) = delete;
+
+		unsigned id() const;
+		int count() const;
+		GLuint type() const;
+
+	protected:
+		unsigned bufferObject_;
+		int count_;
+		GLuint type_;
+	};
 	/**
 	 * @brief describe a Mesh with a single Material, that is drawable with one draw call
 	 */
@@ -119,6 +222,60 @@ namespace ns {
 			const std::vector<unsigned int>& indices,
 			const ns::Material& material = Material::getDefault(), 
 			const MeshConfigInfo& info = MeshConfigInfo());
+		/**
+		 * @brief constructor of an indexed mesh that use an index buffer shared with other meshes
+		 * the index type and the number of indices of info are replaced by the ones of the index buffer
+		 * \param vertices
+		 * \param indices shared index buffer, the mesh keep it alive
+		 * \param material
+		 * \param info
+		 */
+		Mesh(const std::vector<Vertex>& vertices,
+			const std::shared_ptr<const IndexBuffer>& indices,
+			const ns::Material& material = Material::getDefault(),
+			const MeshConfigInfo& info = MeshConfigInfo());
+		/**
+		 * @brief constructor of a mesh with any vertex format
+		 * \param vertices pointer to the vertices
+		 * \param verticesSize size of the vertices in bytes
+		 * \param layout format of the vertices
+		 * \param indices
+		 * \param material
+		 * \param info
+		 */
+		Mesh(const void* vertices, size_t verticesSize,
+			const VertexLayout& layout,
+			const std::vector<unsigned int>& indices,
+			const ns::Material& material = Material::getDefault(),
+			const MeshConfigInfo& info = MeshConfigInfo());
+		/**
+		 * @brief constructor of a mesh with any vertex format and a shared index buffer
+		 * \param vertices pointer to the vertices
+		 * \param verticesSize size of the vertices in bytes
+		 * \param layout format of the vertices
+		 * \param indices shared index buffer, the mesh keep it alive
+		 * \param material
+		 * \param info
+		 */
+		Mesh(const void* vertices, size_t verticesSize,
+			const VertexLayout& layout,
+			const std::shared_ptr<const IndexBuffer>& indices,
+			const ns::Material& material = Material::getDefault(),
+			const MeshConfigInfo& info = MeshConfigInfo());
+		/**
+		 * @brief constructor of a mesh whose vertices are already on the gpu, they are copied by the gpu in the vertex buffer of the mesh
+		 * so the range can be reused once the gpu executed the copy
+		 * \param vertices range of the buffer that contains the vertices
+		 * \param layout format of the vertices
+		 * \param indices shared index buffer, the mesh keep it alive
+		 * \param material
+		 * \param info
+		 */
+		Mesh(const BufferRange& vertices,
+			const VertexLayout& layout,
+			const std::shared_ptr<const IndexBuffer>& indices,
+			const ns::Material& material = Material::getDefault(),
+			const MeshConfigInfo& info = MeshConfigInfo());
 		/**
 		 * @brief (TO DO) constructor to animate the mesh
 		 * \param vertices
@@ -141,19 +298,30 @@ namespace ns {
 		 * \param shader
 		 */
 		virtual void draw(const ns::Shader& shader) const override;
+		/**
+		 * @brief replace the shared index buffer of the mesh by another one with the same index type,
+		 * the triangles change without uploading the vertices again (only for the meshes created with a shared index buffer)
+		 * \param indices
+		 */
+		void setIndices(const std::shared_ptr<const IndexBuffer>& indices);
 
 	protected:
 		unsigned vertexArrayObject_;
 		unsigned vertexBufferObject_;
 		unsigned bonesBufferObject_;
 		unsigned indexBufferObject_;
+		std::shared_ptr<const IndexBuffer> sharedIndices_;	//index buffer owned by several meshes (indexBufferObject_ is then not owned by this mesh)
 
 		Material material_;
 		int numberOfVertices_;
 
 		const MeshConfigInfo info_;
+		const VertexLayout layout_;
 
 	protected:
+		//create the vertex buffer and describe it in the vertex array, the vertex array and the index buffer must be bound before
+		void setupVertexArray(const void* vertices, size_t verticesSize);
+
 		const void* getIndices(const std::vector<unsigned int>& indices,
 			std::vector<unsigned char>& indicesBytes,
 			std::vector<unsigned short>& indicesShorts) const;
@@ -0,0 +1,145 @@
+#include "StagingRing.h"
+
+namespace {
+	//the vertex attributes read floats so the regions are aligned on 16 bytes
+	constexpr size_t alignment = 16;
+}
+
+ns::StagingRing::StagingRing(size_t capacity)
+	:
+	bufferObject_(0),
+	mapped_(nullptr),
+	capacity_(capacity),
+	head_(0),
+	used_(0),
+	nextFence_(1),
+	passedFence_(0)
+{
+	//the context may not support the buffer storage (opengl 4.4)
+	if (!glBufferStorage) return;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+	glGenBuffers(1, &bufferObject_);
+	glBindBuffer(GL_COPY_READ_BUFFER, bufferObject_);
+	glBufferStorage(GL_COPY_READ_BUFFER, capacity_, nullptr, flags);
+	mapped_ = static_cast<uint8_t*>(glMapBufferRange(GL_COPY_READ_BUFFER, 0, capacity_, flags));
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+}
+
+ns::StagingRing::~StagingRing()
+{
+	for (const auto& fence : fences_)
+		glDeleteSync(fence.sync);
+
+	if (!bufferObject_) return;
+
+	glBindBuffer(GL_COPY_READ_BUFFER, bufferObject_);
+	if (mapped_) glUnmapBuffer(GL_COPY_READ_BUFFER);
+	glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+	glDeleteBuffers(1, &bufferObject_);
+}
+
+ns::StagingRing::Region ns::StagingRing::allocate(size_t size)
+{
+	Region ret;
+	if (!mapped_ or size == 0) return ret;
+
+	const size_t aligned = (size + alignment - 1) / alignment * alignment;
+
+	std::scoped_lock lock(mutex_);
+
+	//the free space is after the head until the oldest block (or the end of the buffer if it is before the head)
+	const size_t tail = blocks_.empty() ? head_ : blocks_.front().offset;
+
+	size_t offset = head_;
+	size_t skipped = 0;
+
+	if (used_ == 0) {
+		//empty ring, restart at the beginning to get the largest space
+		offset = 0;
+		head_ = 0;
+		if (aligned > capacity_) return ret;
+	}
+	else if (head_ > tail) {
+		//free space : [head, capacity) and [0, tail)
+		if (capacity_ - head_ < aligned) {
+			if (tail < aligned) return ret;
+			skipped = capacity_ - head_;
+			offset = 0;
+		}
+	}
+	else if (tail - head_ < aligned) {
+		//free space : [head, tail)
+		return ret;
+	}
+
+	//the skipped end of the buffer is freed with the previous block
+	if (skipped) {
+		if (blocks_.size()) blocks_.back().size += skipped;
+		used_ += skipped;
+	}
+
+	blocks_.push_back(Block{ offset, aligned, 0 });
+	used_ += aligned;
+	head_ = (offset + aligned) % capacity_;
+
+	ret.data = mapped_ + offset;
+	ret.offset = offset;
+	ret.size = size;
+	return ret;
+}
+
+void ns::StagingRing::release(const Region& region)
+{
+	if (!region) return;
+
+	std::scoped_lock lock(mutex_);
+
+	//the released regions are usually the oldest ones
+	for (auto& block : blocks_)
+	{
+		if (block.offset != region.offset or block.fence) continue;
+		block.fence = nextFence_;
+		return;
+	}
+}
+
+void ns::StagingRing::fence()
+{
+	if (!mapped_) return;
+
+	//the fences are passed in order, stop at the first one that is not
+	while (fences_.size()) {
+		const GLenum status = glClientWaitSync(fences_.front().sync, 0, 0);
+		if (status != GL_ALREADY_SIGNALED and status != GL_CONDITION_SATISFIED) break;
+
+		passedFence_ = fences_.front().index;
+		glDeleteSync(fences_.front().sync);
+		fences_.pop_front();
+	}
+
+	std::scoped_lock lock(mutex_);
+
+	//free the oldest blocks whose copies are finished (a block that is still used keep the next ones)
+	while (blocks_.size() and blocks_.front().fence and blocks_.front().fence <= passedFence_) {
+		used_ -= blocks_.front().size;
+		blocks_.pop_front();
+	}
+
+	//the regions released during this frame wait for this fence
+	fences_.push_back(Fence{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), nextFence_ });
+	nextFence_++;
+}
+
+GLuint ns::StagingRing::id() const
+{
+	return bufferObject_;
+}
+
+size_t ns::StagingRing::used() const
+{
+	std::scoped_lock lock(mutex_);
+	return used_;
+}
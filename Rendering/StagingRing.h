@@ -0,0 +1,91 @@
+#pragma once
+//glad
+#include <glad/glad.h>
+
+//stl
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+namespace ns {
+	/**
+	 * @brief gpu buffer that stays mapped in the memory of the program, so any thread can write vertices in it and the opengl thread
+	 * only has to copy them in their final buffer on the gpu (no copy on the cpu, no driver allocation).
+	 * The regions are allocated like in a ring: they become free again in the order of the allocations once the gpu has
+	 * executed the copies that read them (a fence is inserted after the copies of each frame).
+	 * If the buffer storage (opengl 4.4) is not supported, allocate() always fails and the callers keep their vertices on the cpu.
+	 */
+	class StagingRing
+	{
+	public:
+		struct Region {
+			void* data = nullptr;		//pointer where the vertices can be written
+			size_t offset = 0;			//offset in the buffer
+			size_t size = 0;
+
+			explicit operator bool() const { return data != nullptr; }
+		};
+
+		/**
+		 * @brief create and map the buffer (need an opengl context)
+		 * \param capacity size of the buffer in bytes
+		 */
+		StagingRing(size_t capacity);
+		/**
+		 * @brief unmap and free the buffer, the gpu must not read it anymore
+		 */
+		~StagingRing();
+
+		StagingRing(const StagingRing&) = delete;
+		StagingRing& operator=(const StagingRing&) = delete;
+		/**
+		 * @brief take a region of the buffer, can be called by any thread
+		 * \param size in bytes
+		 * \return an empty region if the buffer is full
+		 */
+		Region allocate(size_t size);
+		/**
+		 * @brief give back a region after the commands that read it are sent (or if it won't be used)
+		 * it will be reused after the next fence() is passed by the gpu
+		 * \param region
+		 */
+		void release(const Region& region);
+		/**
+		 * @brief insert a fence after the commands of the frame and free the regions whose fence has been passed by the gpu
+		 * (only called by the opengl thread, once per frame)
+		 */
+		void fence();
+		/**
+		 * @brief return the buffer name, to use with GL_COPY_READ_BUFFER
+		 */
+		GLuint id() const;
+		/**
+		 * @brief return the number of allocated bytes (including the regions that wait for the gpu)
+		 */
+		size_t used() const;
+
+	protected:
+		struct Block {
+			size_t offset;
+			size_t size;			//includes the end of the buffer that is skipped when an allocation wraps around
+			uint64_t fence;			//fence after which the block is free, 0 while it is used
+		};
+
+		struct Fence {
+			GLsync sync;
+			uint64_t index;
+		};
+
+		GLuint bufferObject_;
+		uint8_t* mapped_;
+		const size_t capacity_;
+
+		std::deque<Block> blocks_;		//blocks in the order of the allocations
+		std::deque<Fence> fences_;		//fences that the gpu didn't pass yet
+		size_t head_;					//offset of the next allocation
+		size_t used_;
+		uint64_t nextFence_;			//index of the next fence
+		uint64_t passedFence_;			//index of the last fence passed by the gpu
+		mutable std::mutex mutex_;
+	};
+}
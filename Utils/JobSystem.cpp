@@ -0,0 +1,201 @@
+#include "JobSystem.h"
+
+//stl
+#include <iostream>
+#include <exception>
+#include <string>
+
+namespace {
+	//set in each worker thread
+	thread_local const ns::JobSystem* workerSystem = nullptr;
+	thread_local int workerIndex = -1;
+}
+
+ns::JobCounter::JobCounter()
+	:
+	count_(0)
+{}
+
+size_t ns::JobCounter::pending() const
+{
+	return count_.load();
+}
+
+void ns::JobCounter::wait() const
+{
+	waitBelow(1);
+}
+
+void ns::JobCounter::waitBelow(size_t limit) const
+{
+	std::unique_lock lock(mutex_);
+	finished_.wait(lock, [&] { return count_.load() < limit; });
+}
+
+void ns::JobCounter::add()
+{
+	count_++;
+}
+
+void ns::JobCounter::done()
+{
+	//notify under the lock, a waiting thread can destroy the counter as soon as it can take the lock
+	std::scoped_lock lock(mutex_);
+	count_--;
+	finished_.notify_all();
+}
+
+ns::JobSystem::JobSystem(unsigned numberOfThreads)
+	:
+	pending_(0),
+	nextWorker_(0),
+	stop_(false)
+{
+	if (numberOfThreads == 0)
+		numberOfThreads = std::max(std::thread::hardware_concurrency(), 1U);
+
+	for (unsigned i = 0; i < numberOfThreads; i++)
+		workers_.push_back(std::make_unique<Worker>());
+
+	for (unsigned i = 0; i < numberOfThreads; i++)
+		threads_.emplace_back(&JobSystem::workerFunction, this, i);
+}
+
+ns::JobSystem::~JobSystem()
+{
+	{
+		std::scoped_lock lock(sleepMutex_);
+		stop_ = true;
+	}
+	wake_.notify_all();
+
+	for (auto& thread : threads_)
+		thread.join();
+}
+
+ns::JobSystem& ns::JobSystem::get()
+{
+	static JobSystem system;
+	return system;
+}
+
+void ns::JobSystem::submit(Job job, Priority priority, JobCounter* counter)
+{
+	if (counter) counter->add();
+
+	//a worker keep its jobs, the other threads spread them
+	const int current = currentWorker();
+	const size_t index = (current >= 0) ? current : nextWorker_++ % workers_.size();
+
+	//counted before it can be stolen, so the worker that takes it never decrements pending_ below zero
+	{
+		std::scoped_lock lock(sleepMutex_);
+		pending_++;
+	}
+
+	{
+		Worker& worker = *workers_[index];
+		std::scoped_lock lock(worker.mutex);
+		worker.queues[static_cast<size_t>(priority)].push_back({ std::move(job), counter });
+	}
+	wake_.notify_one();
+}
+
+void ns::JobSystem::wait(const JobCounter& counter)
+{
+	const int current = currentWorker();
+	if (current < 0) {
+		counter.wait();
+		return;
+	}
+
+	//a worker can't sleep here or the pool could run out of threads, it execute jobs instead
+	Task task;
+	while (counter.pending()) {
+		if (takeTask(current, task))
+			execute(task);
+		else
+			std::this_thread::yield();
+	}
+
+	//wait for the last done() to release the counter
+	std::scoped_lock lock(counter.mutex_);
+}
+
+unsigned ns::JobSystem::numberOfThreads() const
+{
+	return static_cast<unsigned>(threads_.size());
+}
+
+void ns::JobSystem::workerFunction(unsigned index)
+{
+	workerSystem = this;
+	workerIndex = index;
+
+	Task task;
+	while (true) {
+		if (takeTask(index, task)) {
+			execute(task);
+			continue;
+		}
+
+		std::unique_lock lock(sleepMutex_);
+		wake_.wait(lock, [&] { return pending_.load() > 0 or stop_.load(); });
+
+		if (stop_ and pending_.load() == 0) return;
+	}
+}
+
+bool ns::JobSystem::takeTask(unsigned index, Task& task)
+{
+	const size_t count = workers_.size();
+
+	for (size_t priority = 0; priority < numberOfPriorities; priority++)
+	{
+		//own jobs first (newest one), then steal the oldest job of the others
+		for (size_t offset = 0; offset < count; offset++)
+		{
+			Worker& worker = *workers_[(index + offset) % count];
+			std::scoped_lock lock(worker.mutex);
+
+			auto& queue = worker.queues[priority];
+			if (queue.empty()) continue;
+
+			if (offset == 0) {
+				task = std::move(queue.back());
+				queue.pop_back();
+			}
+			else {
+				task = std::move(queue.front());
+				queue.pop_front();
+			}
+
+			pending_--;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void ns::JobSystem::execute(Task& task)
+{
+	try {
+		task.job();
+	}
+	//a job must not kill a worker, but its error is reported (in one write so the threads don't mix their lines)
+	catch (const std::exception& e) {
+		std::cerr << std::string("job system : a job threw an exception : ") + e.what() + '\n';
+	}
+	catch (...) {
+		std::cerr << "job system : a job threw an unknown exception\n";
+	}
+
+	task.job = nullptr;
+	if (task.counter) task.counter->done();
+}
+
+int ns::JobSystem::currentWorker() const
+{
+	return (workerSystem == this) ? workerIndex : -1;
+}
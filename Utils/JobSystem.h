@@ -0,0 +1,126 @@
+#pragma once
+
+//stl
+#include <vector>
+#include <deque>
+#include <array>
+#include <memory>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace ns {
+	/**
+	 * @brief count the jobs of a group that are not finished, so a thread can wait for them or limit how many are in flight
+	 */
+	class JobCounter
+	{
+	public:
+		JobCounter();
+		/**
+		 * @brief return the number of jobs of the group that are queued or running
+		 */
+		size_t pending() const;
+		/**
+		 * @brief block until all the jobs of the group are finished (don't call it from a job, use JobSystem::wait())
+		 */
+		void wait() const;
+		/**
+		 * @brief block until less than limit jobs of the group are queued or running
+		 * \param limit
+		 */
+		void waitBelow(size_t limit) const;
+
+	protected:
+		std::atomic<size_t> count_;
+		mutable std::mutex mutex_;
+		mutable std::condition_variable finished_;
+
+	protected:
+		void add();
+		void done();
+
+		friend class JobSystem;
+	};
+
+	/**
+	 * @brief pool of worker threads shared by the whole engine.
+	 * Each worker own one deque per priority, it execute its own jobs in the last in first out order and when it has nothing
+	 * to do it steals the oldest jobs of the other workers, so the threads are created once and a long job never block
+	 * the jobs that are queued behind it. The higher priorities are always emptied first.
+	 */
+	class JobSystem
+	{
+	public:
+		using Job = std::function<void()>;
+
+		enum class Priority {
+			high,
+			normal,
+			low
+		};
+		static constexpr size_t numberOfPriorities = 3;
+
+		/**
+		 * @brief start the workers
+		 * \param numberOfThreads 0 use the number of hardware threads
+		 */
+		JobSystem(unsigned numberOfThreads = 0);
+		/**
+		 * @brief finish the queued jobs and join the workers
+		 */
+		~JobSystem();
+
+		JobSystem(const JobSystem&) = delete;
+		JobSystem& operator=(const JobSystem&) = delete;
+		/**
+		 * @brief engine wide job system (created the first time it is used)
+		 */
+		static JobSystem& get();
+		/**
+		 * @brief queue a job
+		 * \param job function to execute on a worker
+		 * \param priority
+		 * \param counter optional group of the job, it is decremented when the job is finished
+		 */
+		void submit(Job job, Priority priority = Priority::normal, JobCounter* counter = nullptr);
+		/**
+		 * @brief wait for a group of jobs, the calling thread execute some jobs while it is waiting if it is a worker
+		 * \param counter
+		 */
+		void wait(const JobCounter& counter);
+
+		unsigned numberOfThreads() const;
+
+	protected:
+		struct Task {
+			Job job;
+			JobCounter* counter;
+		};
+
+		struct Worker {
+			std::mutex mutex;
+			std::array<std::deque<Task>, numberOfPriorities> queues;
+		};
+
+		std::vector<std::unique_ptr<Worker>> workers_;
+		std::vector<std::thread> threads_;
+
+		std::atomic<size_t> pending_;			//number of queued jobs (not the running ones)
+		std::atomic<size_t> nextWorker_;		//round robin of the jobs submitted by the threads that are not workers
+		std::atomic_bool stop_;
+
+		std::mutex sleepMutex_;
+		std::condition_variable wake_;
+
+	protected:
+		void workerFunction(unsigned index);
+		//take a job from the worker deques (its own first), return false if there is none
+		bool takeTask(unsigned index, Task& task);
+		void execute(Task& task);
+		//index of the calling thread if it is a worker of this system, else -1
+		int currentWorker() const;
+	};
+}
@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+namespace ns {
+	template<typename T>
+	/**
+	 * @brief queue where several threads can push values without lock while a single thread consumes them.
+	 * The producers push a node on a lock free stack, the consumer takes the whole stack with one atomic exchange and
+	 * reverses it, so the values are consumed in the order of the pushes and they are moved, never copied.
+	 */
+	class MpscQueue
+	{
+	public:
+		MpscQueue() : head_(nullptr) {}
+		/**
+		 * @brief destroy the values that were not consumed
+		 */
+		~MpscQueue()
+		{
+			consume([](T&) {});
+		}
+
+		MpscQueue(const MpscQueue&) = delete;
+		MpscQueue& operator=(const MpscQueue&) = delete;
+		/**
+		 * @brief add a value, can be called by any thread
+		 * \param value
+		 */
+		void push(T&& value)
+		{
+			Node* node = new Node{ std::move(value), head_.load(std::memory_order_relaxed) };
+			while (!head_.compare_exchange_weak(node->next, node, std::memory_order_release, std::memory_order_relaxed));
+		}
+		/**
+		 * @brief take all the values pushed until now and give them to function in the order of the pushes
+		 * (only one thread can consume at the same time)
+		 * \param function called with a T& for each value
+		 * \return the number of values consumed
+		 */
+		template<typename Function>
+		size_t consume(Function&& function)
+		{
+			Node* node = head_.exchange(nullptr, std::memory_order_acquire);
+
+			//the stack is in the reverse order of the pushes
+			Node* first = nullptr;
+			while (node) {
+				Node* next = node->next;
+				node->next = first;
+				first = node;
+				node = next;
+			}
+
+			size_t ret = 0;
+			while (first) {
+				Node* next = first->next;
+				function(first->value);
+				delete first;
+				first = next;
+				ret++;
+			}
+
+			return ret;
+		}
+		/**
+		 * @brief return true if nothing was pushed since the last consume (the result can be outdated as soon as it is returned)
+		 */
+		bool empty() const
+		{
+			return head_.load(std::memory_order_relaxed) == nullptr;
+		}
+
+	protected:
+		struct Node {
+			T value;
+			Node* next;
+		};
+
+		std::atomic<Node*> head_;
+	};
+}
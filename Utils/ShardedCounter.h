@@ -0,0 +1,67 @@
+#pragma once
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace ns {
+	template<size_t numberOfValues>
+	/**
+	 * @brief store some counters that can be incremented by several threads at the same time without lock.
+	 * Each thread write in its own shard (a cache line), so threads never share a cache line while counting,
+	 * the shards are only read and summed when the total is requested.
+	 */
+	class ShardedCounter
+	{
+	public:
+		ShardedCounter() { reset(); }
+		/**
+		 * @brief add a value to one counter of the calling thread's shard
+		 * \param counter index of the counter
+		 * \param amount value to add
+		 */
+		void add(size_t counter, uint64_t amount)
+		{
+			shards_[threadShard()].values[counter].fetch_add(amount, std::memory_order_relaxed);
+		}
+		/**
+		 * @brief sum the shards of one counter (the result can miss the additions made during the call)
+		 * \param counter index of the counter
+		 * \return the total
+		 */
+		uint64_t total(size_t counter) const
+		{
+			uint64_t ret = 0;
+			for (const auto& shard : shards_)
+				ret += shard.values[counter].load(std::memory_order_relaxed);
+			return ret;
+		}
+		/**
+		 * @brief set all the counters to zero
+		 */
+		void reset()
+		{
+			for (auto& shard : shards_)
+				for (auto& value : shard.values)
+					value.store(0, std::memory_order_relaxed);
+		}
+
+		static constexpr size_t numberOfShards = 64;
+		static constexpr size_t cacheLineSize = 64;
+
+	protected:
+		struct alignas(cacheLineSize) Shard {
+			std::array<std::atomic_uint64_t, numberOfValues> values;
+		};
+
+		std::array<Shard, numberOfShards> shards_;
+
+	protected:
+		//each thread receive a shard index the first time it count something
+		static size_t threadShard()
+		{
+			static std::atomic_size_t nextShard = 0;
+			thread_local const size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % numberOfShards;
+			return shard;
+		}
+	};
+}
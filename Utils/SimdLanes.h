@@ -0,0 +1,137 @@
+#pragma once
+
+//detect the instruction set, NS_SIMD_LANES is defined when one of them is available
+#if defined(__AVX2__)
+#	define NS_SIMD_AVX2
+#	define NS_SIMD_LANES
+#	include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define NS_SIMD_SSE2
+#	define NS_SIMD_LANES
+#	include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#	define NS_SIMD_NEON
+#	define NS_SIMD_LANES
+#	include <arm_neon.h>
+#endif
+
+#include <cstddef>
+
+namespace ns::simd {
+#if defined(NS_SIMD_AVX2)
+	/**
+	 * @brief thin wrapper over the registers of the instruction set, so the same algorithm is written once for avx2, sse2 and neon
+	 * F holds floats, I holds ints and M holds the masks of the comparisons, each one has width lanes
+	 */
+	struct Lanes {
+		static constexpr size_t width = 8;
+		using F = __m256;
+		using I = __m256i;
+		using M = __m256;
+
+		static F load(const float* ptr) { return _mm256_loadu_ps(ptr); }
+		static void store(float* ptr, F v) { _mm256_storeu_ps(ptr, v); }
+		static F set(float v) { return _mm256_set1_ps(v); }
+		static I set(int v) { return _mm256_set1_epi32(v); }
+		static F add(F a, F b) { return _mm256_add_ps(a, b); }
+		static F sub(F a, F b) { return _mm256_sub_ps(a, b); }
+		static F mul(F a, F b) { return _mm256_mul_ps(a, b); }
+		static F max(F a, F b) { return _mm256_max_ps(a, b); }
+		static F abs(F a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.f), a); }
+		static M greater(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+		static M greaterEqual(F a, F b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+		static M maskAnd(M a, M b) { return _mm256_and_ps(a, b); }
+		static M maskOr(M a, M b) { return _mm256_or_ps(a, b); }
+		static F select(M mask, F a, F b) { return _mm256_blendv_ps(b, a, mask); }
+		static I truncate(F a) { return _mm256_cvttps_epi32(a); }
+		static F toFloat(I a) { return _mm256_cvtepi32_ps(a); }
+		static I add(I a, I b) { return _mm256_add_epi32(a, b); }
+		static I sub(I a, I b) { return _mm256_sub_epi32(a, b); }
+		static I bitAnd(I a, I b) { return _mm256_and_si256(a, b); }
+		static I maskToOne(M mask) { return _mm256_and_si256(_mm256_castps_si256(mask), _mm256_set1_epi32(1)); }
+		static I gather(const int* table, I index) { return _mm256_i32gather_epi32(table, index, 4); }
+		static F gather(const float* table, I index) { return _mm256_i32gather_ps(table, index, 4); }
+	};
+#elif defined(NS_SIMD_SSE2)
+	struct Lanes {
+		static constexpr size_t width = 4;
+		using F = __m128;
+		using I = __m128i;
+		using M = __m128;
+
+		static F load(const float* ptr) { return _mm_loadu_ps(ptr); }
+		static void store(float* ptr, F v) { _mm_storeu_ps(ptr, v); }
+		static F set(float v) { return _mm_set1_ps(v); }
+		static I set(int v) { return _mm_set1_epi32(v); }
+		static F add(F a, F b) { return _mm_add_ps(a, b); }
+		static F sub(F a, F b) { return _mm_sub_ps(a, b); }
+		static F mul(F a, F b) { return _mm_mul_ps(a, b); }
+		static F max(F a, F b) { return _mm_max_ps(a, b); }
+		static F abs(F a) { return _mm_andnot_ps(_mm_set1_ps(-0.f), a); }
+		static M greater(F a, F b) { return _mm_cmpgt_ps(a, b); }
+		static M greaterEqual(F a, F b) { return _mm_cmpge_ps(a, b); }
+		static M maskAnd(M a, M b) { return _mm_and_ps(a, b); }
+		static M maskOr(M a, M b) { return _mm_or_ps(a, b); }
+		static F select(M mask, F a, F b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		static I truncate(F a) { return _mm_cvttps_epi32(a); }
+		static F toFloat(I a) { return _mm_cvtepi32_ps(a); }
+		static I add(I a, I b) { return _mm_add_epi32(a, b); }
+		static I sub(I a, I b) { return _mm_sub_epi32(a, b); }
+		static I bitAnd(I a, I b) { return _mm_and_si128(a, b); }
+		static I maskToOne(M mask) { return _mm_and_si128(_mm_castps_si128(mask), _mm_set1_epi32(1)); }
+		//sse2 has no gather instruction so the lookups are made lane by lane
+		static I gather(const int* table, I index) {
+			alignas(16) int lanes[width];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), index);
+			return _mm_setr_epi32(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]);
+		}
+		static F gather(const float* table, I index) {
+			alignas(16) int lanes[width];
+			_mm_store_si128(reinterpret_cast<__m128i*>(lanes), index);
+			return _mm_setr_ps(table[lanes[0]], table[lanes[1]], table[lanes[2]], table[lanes[3]]);
+		}
+	};
+#elif defined(NS_SIMD_NEON)
+	struct Lanes {
+		static constexpr size_t width = 4;
+		using F = float32x4_t;
+		using I = int32x4_t;
+		using M = uint32x4_t;
+
+		static F load(const float* ptr) { return vld1q_f32(ptr); }
+		static void store(float* ptr, F v) { vst1q_f32(ptr, v); }
+		static F set(float v) { return vdupq_n_f32(v); }
+		static I set(int v) { return vdupq_n_s32(v); }
+		static F add(F a, F b) { return vaddq_f32(a, b); }
+		static F sub(F a, F b) { return vsubq_f32(a, b); }
+		static F mul(F a, F b) { return vmulq_f32(a, b); }
+		static F max(F a, F b) { return vmaxq_f32(a, b); }
+		static F abs(F a) { return vabsq_f32(a); }
+		static M greater(F a, F b) { return vcgtq_f32(a, b); }
+		static M greaterEqual(F a, F b) { return vcgeq_f32(a, b); }
+		static M maskAnd(M a, M b) { return vandq_u32(a, b); }
+		static M maskOr(M a, M b) { return vorrq_u32(a, b); }
+		static F select(M mask, F a, F b) { return vbslq_f32(mask, a, b); }
+		static I truncate(F a) { return vcvtq_s32_f32(a); }
+		static F toFloat(I a) { return vcvtq_f32_s32(a); }
+		static I add(I a, I b) { return vaddq_s32(a, b); }
+		static I sub(I a, I b) { return vsubq_s32(a, b); }
+		static I bitAnd(I a, I b) { return vandq_s32(a, b); }
+		static I maskToOne(M mask) { return vandq_s32(vreinterpretq_s32_u32(mask), vdupq_n_s32(1)); }
+		//neon has no gather instruction so the lookups are made lane by lane
+		static I gather(const int* table, I index) {
+			int lanes[width];
+			vst1q_s32(lanes, index);
+			for (size_t i = 0; i < width; i++) lanes[i] = table[lanes[i]];
+			return vld1q_s32(lanes);
+		}
+		static F gather(const float* table, I index) {
+			int lanes[width];
+			float values[width];
+			vst1q_s32(lanes, index);
+			for (size_t i = 0; i < width; i++) values[i] = table[lanes[i]];
+			return vld1q_f32(values);
+		}
+	};
+#endif
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <configNoisy.hpp>
+
+//stl
+#include <array>
+#include <cstdint>
+
+namespace ns {
+	//shape of the rings of a SpiralOrder
+	enum class SpiralShape : uint8_t {
+		square,		//the ring d holds the offsets at a chebyshev distance of d, it is the border of a square of width 2 * d + 1
+		circle		//the ring d holds the offsets whose euclidean distance is in ]d - 1, d], the rings fill a disk
+	};
+
+	//compile time generation of the tables
+	namespace spiral {
+		constexpr int isqrt(int value)
+		{
+			if (value < 2) return value;
+
+			//newton's method from an upper bound, the sequence decreases until the root
+			int root = value;
+			int next = (root + 1) / 2;
+			while (next < root)
+			{
+				root = next;
+				next = (root + value / root) / 2;
+			}
+			return root;
+		}
+
+		template<SpiralShape shape>
+		constexpr size_t ringSize(unsigned d)
+		{
+			if (d == 0) return 1;
+
+			if constexpr (shape == SpiralShape::square) {
+				return 8 * static_cast<size_t>(d);
+			}
+			else {
+				//cells of the disk of radius d minus the ones of the disk of radius d - 1, one column at a time
+				const int outer = static_cast<int>(d) * static_cast<int>(d);
+				const int inner = static_cast<int>(d - 1) * static_cast<int>(d - 1);
+
+				size_t count = 0;
+				for (int y = -static_cast<int>(d); y <= static_cast<int>(d); y++)
+				{
+					count += 2 * isqrt(outer - y * y) + 1;
+					if (inner >= y * y)
+						count -= 2 * isqrt(inner - y * y) + 1;
+				}
+				return count;
+			}
+		}
+
+		template<SpiralShape shape>
+		constexpr size_t tableSize()
+		{
+			size_t size = 0;
+			for (unsigned d = 0; d < maximunRenderDistance; d++)
+				size += ringSize<shape>(d);
+			return size;
+		}
+
+		template<SpiralShape shape>
+		constexpr std::array<uint32_t, maximunRenderDistance + 1> generateRingOffsets()
+		{
+			std::array<uint32_t, maximunRenderDistance + 1> offsets{};
+			for (unsigned d = 0; d < maximunRenderDistance; d++)
+				offsets[d + 1] = offsets[d] + static_cast<uint32_t>(ringSize<shape>(d));
+			return offsets;
+		}
+
+		template<SpiralShape shape>
+		constexpr std::array<glm::ivec2, tableSize<shape>()> generateTable()
+		{
+			std::array<glm::ivec2, tableSize<shape>()> table{};
+
+			//central chunk offset is of course null
+			table[0] = glm::ivec2(0, 0);
+			size_t cursor = 1;
+
+			for (int d = 1; d < static_cast<int>(maximunRenderDistance); d++)
+			{
+				if constexpr (shape == SpiralShape::square) {
+					//start by the corner (d, d) and turn counterclockwise until the cell just under it at (d, d - 1)
+					int x = d;
+					int y = d;
+					table[cursor++] = glm::ivec2(x, y);
+
+					for (int i = 0; i < d * 2; i++)
+						table[cursor++] = glm::ivec2(--x, y);
+					for (int i = 0; i < d * 2; i++)
+						table[cursor++] = glm::ivec2(x, --y);
+					for (int i = 0; i < d * 2; i++)
+						table[cursor++] = glm::ivec2(++x, y);
+					for (int i = 0; i < d * 2 - 1; i++)
+						table[cursor++] = glm::ivec2(x, ++y);
+				}
+				else {
+					//each line of the ring is made of one segment, or of two segments on both sides of the disk of radius d - 1
+					const int outer = d * d;
+					const int inner = (d - 1) * (d - 1);
+
+					for (int y = d; y >= -d; y--)
+					{
+						const int width = isqrt(outer - y * y);
+						const int hole = inner >= y * y ? isqrt(inner - y * y) : -1;
+
+						if (hole < 0) {
+							for (int x = -width; x <= width; x++)
+								table[cursor++] = glm::ivec2(x, y);
+						}
+						else {
+							for (int x = -width; x < -hole; x++)
+								table[cursor++] = glm::ivec2(x, y);
+							for (int x = hole + 1; x <= width; x++)
+								table[cursor++] = glm::ivec2(x, y);
+						}
+					}
+				}
+			}
+			return table;
+		}
+	}
+
+	template<SpiralShape shape>
+	/**
+	 * @brief list of grid offsets around a central cell, sorted from the center to the outside ring by ring.
+	 * The table is generated at compile time in a single contiguous array with the offsets of the first element of each ring,
+	 * iterating over the rings [0, d] visits each offset of the square (or of the disk) of radius d exactly once.
+	 */
+	class SpiralOrder
+	{
+	public:
+		//number of rings in the table
+		static constexpr unsigned rings = maximunRenderDistance;
+
+		/**
+		 * @brief contiguous view over the offsets of one ring
+		 */
+		class Ring
+		{
+		public:
+			constexpr Ring(const glm::ivec2* begin, const glm::ivec2* end) : begin_(begin), end_(end) {}
+
+			constexpr const glm::ivec2* begin() const { return begin_; }
+			constexpr const glm::ivec2* end() const { return end_; }
+			constexpr size_t size() const { return static_cast<size_t>(end_ - begin_); }
+			constexpr const glm::ivec2& operator[](size_t i) const { return begin_[i]; }
+
+		protected:
+			const glm::ivec2* begin_;
+			const glm::ivec2* end_;
+		};
+
+		/**
+		 * \param distance index of the ring, must be lower than rings
+		 * \return the offsets of the ring
+		 */
+		static constexpr Ring ring(unsigned distance);
+		/**
+		 * \param distance index of the last ring, must be lower than rings
+		 * \return the offsets of all the rings in [0, distance]
+		 */
+		static constexpr Ring disk(unsigned distance);
+		/**
+		 * \return the number of offsets in the table
+		 */
+		static constexpr size_t size();
+
+	protected:
+		//index of the first offset of each ring, ringOffsets_[rings] is the size of the table
+		static constexpr std::array<uint32_t, rings + 1> ringOffsets_ = spiral::generateRingOffsets<shape>();
+		static constexpr std::array<glm::ivec2, spiral::tableSize<shape>()> table_ = spiral::generateTable<shape>();
+	};
+
+	//shared tables
+	using SquareSpiral = SpiralOrder<SpiralShape::square>;
+	using CircleSpiral = SpiralOrder<SpiralShape::circle>;
+
+
+	//inline functions
+
+	template<SpiralShape shape>
+	inline constexpr typename SpiralOrder<shape>::Ring SpiralOrder<shape>::ring(unsigned distance)
+	{
+		return Ring(table_.data() + ringOffsets_[distance], table_.data() + ringOffsets_[distance + 1]);
+	}
+
+	template<SpiralShape shape>
+	inline constexpr typename SpiralOrder<shape>::Ring SpiralOrder<shape>::disk(unsigned distance)
+	{
+		return Ring(table_.data(), table_.data() + ringOffsets_[distance + 1]);
+	}
+
+	template<SpiralShape shape>
+	inline constexpr size_t SpiralOrder<shape>::size()
+	{
+		return table_.size();
+	}
+}
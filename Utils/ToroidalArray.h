@@ -0,0 +1,205 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <vector>
+#include <Utils/utils.h>
+
+namespace ns {
+	template<typename T>
+	/**
+	 * @brief window of size x * y over an infinite grid, the elements are addressed with their position on the grid.
+	 * The element of a position is always stored at the position modulo the size of the window (the array wraps around like a torus),
+	 * so moving the window never moves the elements: only the ones that leave the window are released and their memory is reused
+	 * by the positions that enter it.
+	 */
+	class ToroidalArray
+	{
+	public:
+		/**
+		 * @brief allocate the elements of the window
+		 * \param size width and height of the window
+		 * \param origin position of the first element of the window
+		 */
+		ToroidalArray(const glm::ivec2& size, const glm::ivec2& origin = glm::ivec2(0));
+		/**
+		 * \return the width and the height of the window
+		 */
+		const glm::ivec2& size() const;
+		/**
+		 * \return the position of the first element of the window
+		 */
+		const glm::ivec2& origin() const;
+		/**
+		 * @brief check that a position is in the window
+		 * \param position
+		 */
+		bool contains(const glm::ivec2& position) const;
+		/**
+		 * @brief return a reference to the element of a position of the window
+		 * \param position
+		 * \return T reference
+		 */
+		T& value(const glm::ivec2& position);
+		/**
+		 * @brief return a const reference to the element of a position of the window
+		 * \param position
+		 * \return const T reference
+		 */
+		const T& value(const glm::ivec2& position) const;
+		/**
+		 * @brief move the window, the elements that leave it are given to release and then reset to T()
+		 * the cost only depends on the number of elements that leave the window
+		 * \param origin new position of the first element of the window
+		 * \param release function called with each element that leaves the window
+		 */
+		template<typename Release>
+		void move(const glm::ivec2& origin, Release&& release);
+		/**
+		 * @brief change the size and the position of the window, the elements that stay in the window are kept
+		 * \param size new width and height of the window
+		 * \param origin new position of the first element of the window
+		 * \param release function called with each element that leaves the window
+		 */
+		template<typename Release>
+		void resize(const glm::ivec2& size, const glm::ivec2& origin, Release&& release);
+
+	protected:
+		glm::ivec2 size_;
+		glm::ivec2 origin_;
+		std::vector<T> elements_;
+
+	protected:
+		size_t index(const glm::ivec2& position) const;
+		//call function with each position of the window [origin, origin + size) that is not in the window [keptOrigin, keptOrigin + size)
+		template<typename Function>
+		static void forEachOutside(const glm::ivec2& origin, const glm::ivec2& size, const glm::ivec2& keptOrigin, const glm::ivec2& keptSize, Function&& function);
+	};
+
+
+	//inline functions
+
+	template<typename T>
+	inline ToroidalArray<T>::ToroidalArray(const glm::ivec2& size, const glm::ivec2& origin)
+		:
+		size_(size),
+		origin_(origin),
+		elements_((size_t)size.x * (size_t)size.y)
+	{
+#		ifndef NDEBUG
+		_STL_ASSERT(size.x > 0, "x's toroidal array must be positive");
+		_STL_ASSERT(size.y > 0, "y's toroidal array must be positive");
+#		endif // !NDEBUG
+	}
+
+	template<typename T>
+	inline const glm::ivec2& ToroidalArray<T>::size() const
+	{
+		return size_;
+	}
+
+	template<typename T>
+	inline const glm::ivec2& ToroidalArray<T>::origin() const
+	{
+		return origin_;
+	}
+
+	template<typename T>
+	inline bool ToroidalArray<T>::contains(const glm::ivec2& position) const
+	{
+		const glm::ivec2 location = position - origin_;
+		return location.x >= 0 and location.y >= 0 and location.x < size_.x and location.y < size_.y;
+	}
+
+	template<typename T>
+	inline T& ToroidalArray<T>::value(const glm::ivec2& position)
+	{
+#		ifndef NDEBUG
+		_STL_ASSERT(contains(position), "ToroidalArray position out of the window");
+#		endif
+
+		return elements_[index(position)];
+	}
+
+	template<typename T>
+	inline const T& ToroidalArray<T>::value(const glm::ivec2& position) const
+	{
+#		ifndef NDEBUG
+		_STL_ASSERT(contains(position), "ToroidalArray position out of the window");
+#		endif
+
+		return elements_[index(position)];
+	}
+
+	template<typename T>
+	template<typename Release>
+	inline void ToroidalArray<T>::move(const glm::ivec2& origin, Release&& release)
+	{
+		//the positions that enter the window use the elements of the ones that leave it
+		forEachOutside(origin_, size_, origin, size_, [&](const glm::ivec2& position) {
+			T& element = elements_[index(position)];
+			release(element);
+			element = T();
+		});
+
+		origin_ = origin;
+	}
+
+	template<typename T>
+	template<typename Release>
+	inline void ToroidalArray<T>::resize(const glm::ivec2& size, const glm::ivec2& origin, Release&& release)
+	{
+		forEachOutside(origin_, size_, origin, size, [&](const glm::ivec2& position) {
+			release(elements_[index(position)]);
+		});
+
+		ToroidalArray<T> resized(size, origin);
+
+		//move the elements that are in both windows
+		const glm::ivec2 begin = glm::max(origin_, origin);
+		const glm::ivec2 end = glm::min(origin_ + size_, origin + size);
+		for (int y = begin.y; y < end.y; y++)
+		{
+			for (int x = begin.x; x < end.x; x++)
+			{
+				resized.value(glm::ivec2(x, y)) = std::move(value(glm::ivec2(x, y)));
+			}
+		}
+
+		*this = std::move(resized);
+	}
+
+	template<typename T>
+	inline size_t ToroidalArray<T>::index(const glm::ivec2& position) const
+	{
+		//positive modulo
+		const int x = ((position.x % size_.x) + size_.x) % size_.x;
+		const int y = ((position.y % size_.y) + size_.y) % size_.y;
+		return (size_t)x + (size_t)y * (size_t)size_.x;
+	}
+
+	template<typename T>
+	template<typename Function>
+	inline void ToroidalArray<T>::forEachOutside(const glm::ivec2& origin, const glm::ivec2& size, const glm::ivec2& keptOrigin, const glm::ivec2& keptSize, Function&& function)
+	{
+		const glm::ivec2 end = origin + size;
+		const glm::ivec2 keptEnd = keptOrigin + keptSize;
+
+		//range of the columns that are in both windows (empty if they don't overlap)
+		const int columnsBegin = glm::clamp(keptOrigin.x, origin.x, end.x);
+		const int columnsEnd = glm::clamp(keptEnd.x, columnsBegin, end.x);
+
+		for (int y = origin.y; y < end.y; y++)
+		{
+			//the whole line is outside
+			if (y < keptOrigin.y or y >= keptEnd.y) {
+				for (int x = origin.x; x < end.x; x++)
+					function(glm::ivec2(x, y));
+				continue;
+			}
+
+			for (int x = origin.x; x < columnsBegin; x++)
+				function(glm::ivec2(x, y));
+			for (int x = columnsEnd; x < end.x; x++)
+				function(glm::ivec2(x, y));
+		}
+	}
+}
@@ -1,6 +1,10 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+//compact terrain vertices (ns::TerrainVertex)
+layout (location = 7) in vec2 inGridPos;
+layout (location = 8) in float inHeight;
+layout (location = 9) in vec2 inOctahedralNormal;
 
 out VS_OUT {
     vec3 normal;
@@ -8,10 +12,27 @@ out VS_OUT {
 
 uniform mat4 view;
 uniform mat4 model;
+uniform bool compactVertices;
+uniform vec2 gridSpacing;
+
+vec3 octahedralDecode(vec2 e){
+	vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+	if(n.y < 0.0)
+		n.xz = (1.0 - abs(n.zx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
 
 void main()
 {
+    vec3 position = aPos;
+    vec3 normal = aNormal;
+    if(compactVertices)
+    {
+        position = vec3(inGridPos.x * gridSpacing.x, inHeight, inGridPos.y * gridSpacing.y);
+        normal = octahedralDecode(inOctahedralNormal);
+    }
+
     mat3 normalMatrix = mat3(transpose(inverse(view * model)));
-    vs_out.normal = vec3(vec4(normalMatrix * aNormal, 0.0));
-    gl_Position = view * model * vec4(aPos, 1.0); 
-}
\ No newline at end of file
+    vs_out.normal = vec3(vec4(normalMatrix * normal, 0.0));
+    gl_Position = view * model * vec4(position, 1.0); 
+}
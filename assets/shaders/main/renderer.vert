@@ -25,11 +25,17 @@ layout(location = 4) in vec3 inBitangent;
 //animation
 layout(location = 5) in ivec4 inBonesIDs;
 layout(location = 6) in vec4 inWeights;
+//compact terrain vertices (ns::TerrainVertex)
+layout(location = 7) in vec2 inGridPos;
+layout(location = 8) in float inHeight;
+layout(location = 9) in vec2 inOctahedralNormal;
 
 
 uniform MAT4P model;
 uniform MAT4P projView;
 uniform bool computeBitangents;
+uniform bool compactVertices;
+uniform vec2 gridSpacing;
 uniform mat4 bones[ANIMATIONS_MAX_BONES];
 
 out vec2 uv;
@@ -41,22 +47,39 @@ out mat3 TBN;
 out vec4 lightFragPos;
 uniform mat4 lightSpaceMatrix;
 
+vec3 octahedralDecode(vec2 e){
+	vec3 n = vec3(e.x, 1.0 - abs(e.x) - abs(e.y), e.y);
+	if(n.y < 0.0)
+		n.xz = (1.0 - abs(n.zx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.z >= 0.0 ? 1.0 : -1.0);
+	return normalize(n);
+}
+
 void main(){
+	vec3 position = inPos;
+	vec3 normal = inNormal;
+	vec3 tangent = inTangent;
+	if(compactVertices)
+	{
+		position = vec3(inGridPos.x * gridSpacing.x, inHeight, inGridPos.y * gridSpacing.y);
+		normal = octahedralDecode(inOctahedralNormal);
+		tangent = vec3(1, 0, 0);
+	}
+
 	//const mat4 animation = mat4(1);
 	//bones[inBonesIDs[0]] * inWeights[0] +
     //bones[inBonesIDs[1]] * inWeights[1] +
     //bones[inBonesIDs[2]] * inWeights[2] +
     //bones[inBonesIDs[3]] * inWeights[3];
 
-	gl_Position = vec4(projView * model * VEC4P(inPos, 1.0));
+	gl_Position = vec4(projView * model * VEC4P(position, 1.0));
 
 	uv = inUv;
-	outNormal = normalize(inNormal);
-	fragPos = VEC3P(model * VEC4P(inPos, 1));
+	outNormal = normalize(normal);
+	fragPos = VEC3P(model * VEC4P(position, 1));
 
-	vec3 T = vec3(normalize(VEC3P(model * VEC4P(inTangent, 0.0))));
+	vec3 T = vec3(normalize(VEC3P(model * VEC4P(tangent, 0.0))));
 	vec3 B;
-    vec3 N = vec3(normalize(VEC3P(model * VEC4P(inNormal, 0.0))));
+    vec3 N = vec3(normalize(VEC3P(model * VEC4P(normal, 0.0))));
 
 	if(computeBitangents)
 	{
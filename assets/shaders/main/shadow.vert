@@ -1,9 +1,15 @@
 #version 430 core
 layout(location = 0) in vec3 aPos;
+//compact terrain vertices (ns::TerrainVertex)
+layout(location = 7) in vec2 inGridPos;
+layout(location = 8) in float inHeight;
 
 uniform mat4 lightSpaceMatrix;
 uniform mat4 model;
+uniform bool compactVertices;
+uniform vec2 gridSpacing;
 
 void main(){
-	gl_Position = lightSpaceMatrix * model * vec4(aPos, 1);
+	vec3 position = compactVertices ? vec3(inGridPos.x * gridSpacing.x, inHeight, inGridPos.y * gridSpacing.y) : aPos;
+	gl_Position = lightSpaceMatrix * model * vec4(position, 1);
 }
\ No newline at end of file
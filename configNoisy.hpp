@@ -19,6 +19,13 @@
 
 #define OPENGL_LOG_PERFORMANCE_ISSUES false
 
+//when true the height map generators count the samples and the octaves they compute and the time spent (can be enabled in release builds)
+#ifndef NDEBUG
+#define NS_TERRAIN_STATISTICS true
+#else
+#define NS_TERRAIN_STATISTICS false
+#endif // !NDEBUG
+
 //macros to make sintax faster and more readable
 #define dout std::cout //ns::Debug::get()
 #define newl '\n'
@@ -45,7 +45,7 @@ int ns::GeneratorInterface::run()
 	generation_.exponent = 1;
 
 
-	plane_ = std::make_unique<PlaneGeneration>(generation_, chunkSize_, chunkRes_);
+	plane_ = std::make_unique<PlaneGeneration>(generation_, chunkSize_, chunkRes_, diskCacheDirectory());
 	plane_->renderer.setRenderDistance(8);
 
 	DirectionalLight sun;
@@ -62,18 +62,16 @@ int ns::GeneratorInterface::run()
 
 		ImGui::End();
 
-		plane_->renderer.update(ns::GridPositionType(0));
+		plane_->renderer.update(cam_);
 
 		cam_.classicKeyboardControls(window_, settings_.cameraSpeed);
 		cam_.classicMouseControls(window_, settings_.mouseSensivity);
 
-		//scene_ = initialScene + plane_->renderer.lockScene();
+		//scene_ = initialScene + plane_->renderer.scene();
 
 		renderer_.startRendering();
 		renderer_.finishRendering();
 
-		plane_->renderer.unlockScene();
-
 		Debug::get().render();
 
 		window_.inputFullscreen(GLFW_KEY_F11);
@@ -98,7 +96,15 @@ void ns::GeneratorInterface::mainMenu()
 	SliderFloat("##mouse sensivity", &settings_.mouseSensivity, .001f, .02f);
 
 	//Text(("number of vertices : " + std::to_string((settings.numberOfPartitions.x + 1) * (settings.numberOfPartitions.y + 1))).c_str());
-	//Text(("number of computed heights : " + std::to_string(heightComputationCount)).c_str());
+
+#	if NS_TERRAIN_STATISTICS
+	const auto stats = plane_->heightFunction.statistics();
+	Text(("number of computed heights : " + std::to_string(stats.samples)).c_str());
+	Text(("number of computed octaves : " + std::to_string(stats.octaves)).c_str());
+	Text(("time spent computing heights : " + std::to_string(stats.seconds) + " s").c_str());
+	if (Button("log heights redundancy"))
+		debugOptimisationHeightsComputations();
+#	endif // NS_TERRAIN_STATISTICS
 }
 
 void ns::GeneratorInterface::generationMenu()
@@ -109,6 +115,12 @@ void ns::GeneratorInterface::generationMenu()
 		int buf = plane_->renderer.renderDistance();
 		Text("renderDistance"); SameLine(); SliderInt("##renderDistance", &buf, 0, 100);
 		plane_->renderer.setRenderDistance(buf);
+		buf = plane_->renderer.levelOfDetailDistance();
+		Text("lodDistance"); SameLine(); SliderInt("##lodDistance", &buf, 0, 32);
+		plane_->renderer.setLevelOfDetailDistance(buf);
+		float budget = plane_->renderer.uploadBudget();
+		Text("uploadBudget (ms)"); SameLine(); SliderFloat("##uploadBudget", &budget, .1f, 16.f);
+		plane_->renderer.setUploadBudget(budget);
 		Separator();
 
 		for (size_t i = 0; i < generation_.octaves.size(); i++)
@@ -118,14 +130,23 @@ void ns::GeneratorInterface::generationMenu()
 
 		Separator();
 
+		//applied at the next regeneration
+		Text("disk cache"); SameLine();
+		Checkbox("##diskCache", &settings_.diskCache);
+
 		if (Button("regenerate")) {
-			plane_ = std::make_unique<PlaneGeneration>(generation_, chunkSize_, chunkRes_);
+			plane_ = std::make_unique<PlaneGeneration>(generation_, chunkSize_, chunkRes_, diskCacheDirectory());
 			plane_->renderer.setRenderDistance(8);
 			plane_->renderer.setMaxOfLoadingThreads(1);
 		}
 	}
 }
 
+std::string ns::GeneratorInterface::diskCacheDirectory() const
+{
+	return settings_.diskCache ? settings_.cacheDirectory : std::string();
+}
+
 void ns::GeneratorInterface::inputOctave(ns::Plane::HeightMapGenerator::Octave& octave, int index)
 {
 	using namespace ImGui;
@@ -150,6 +171,20 @@ void ns::GeneratorInterface::inputOctave(ns::Plane::HeightMapGenerator::Octave&
 
 void ns::GeneratorInterface::debugOptimisationHeightsComputations()
 {
+#	if NS_TERRAIN_STATISTICS
+	//compare the number of heights computed with the number of vertices of the chunks
+	const auto stats = plane_->heightFunction.statistics();
+	const size_t verticesPerChunk = (chunkRes_.x + 1) * (chunkRes_.y + 1);
+	const size_t numberOfChunks = plane_->renderer.numberOfLoadedChunks();
+
+	Debug::get() << stats.samples << " heights computed for " << numberOfChunks << " chunks ("
+		<< numberOfChunks * verticesPerChunk << " vertices)\n";
+	if (numberOfChunks)
+		Debug::get() << "each vertex height has been computed " << (double)stats.samples / (double)(numberOfChunks * verticesPerChunk) << " times on average\n";
+	if (stats.samples)
+		Debug::get() << "a height takes " << stats.seconds * 1e9 / (double)stats.samples << " ns to compute\n";
+#	endif // NS_TERRAIN_STATISTICS
+
 	std::unordered_map<LengthType, std::unordered_map<LengthType, std::optional<unsigned>>> count;
 
 	for (const auto& pos : heightComputationPos)
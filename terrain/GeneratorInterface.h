@@ -10,6 +10,8 @@ namespace ns {
 	struct GeneratorInterfaceSettings {
 		float mouseSensivity = .004f;
 		float cameraSpeed = 5.f;
+		bool diskCache = false;		//store the heights in cacheDirectory (each tweak of the generation is a new configuration)
+		std::string cacheDirectory = "cache/terrain";
 	};
 
 	class GeneratorInterface {
@@ -31,10 +33,11 @@ namespace ns {
 		ChunkPartitionType chunkRes_;
 
 		struct PlaneGeneration {
-			PlaneGeneration(const ns::Plane::HeightMapGenerator::Settings heightGenerationSettings, const MapLengthType& chunkSize, const ChunkPartitionType& numberOfParts) :
+			//no disk cache if diskCacheDirectory is empty
+			PlaneGeneration(const ns::Plane::HeightMapGenerator::Settings heightGenerationSettings, const MapLengthType& chunkSize, const ChunkPartitionType& numberOfParts, const std::string& diskCacheDirectory) :
 				heightFunction(heightGenerationSettings),
 				terrainSettings({ chunkSize , numberOfParts }),
-				renderer(terrainSettings, heightFunction)
+				renderer(terrainSettings, heightFunction, diskCacheDirectory)
 			{}
 			Plane::HeightMapGenerator heightFunction;
 			Plane::FlatTerrainScene::Settings terrainSettings;
@@ -54,6 +57,7 @@ namespace ns {
 
 		void mainMenu();
 		void generationMenu();
+		std::string diskCacheDirectory() const;
 
 		void inputOctave(ns::Plane::HeightMapGenerator::Octave& octave, int index);
 		void debugOptimisationHeightsComputations(); //count if the height function is called multiple times for the same point
@@ -0,0 +1,86 @@
+#include "BorderCache.h"
+
+ns::Plane::BorderCache::BorderCache(size_t capacity)
+	:
+	capacity_(capacity)
+{}
+
+void ns::Plane::BorderCache::store(const GridPositionType& chunk, unsigned edge, Border&& border)
+{
+	std::scoped_lock lock(mutex_);
+
+	const Key key{ chunk, edge };
+	auto it = borders_.find(key);
+	if (it != borders_.end()) {
+		//a border stored again becomes the newest one
+		it->second.border = std::move(border);
+		order_.splice(order_.end(), order_, it->second.position);
+		return;
+	}
+
+	order_.push_back(key);
+	borders_.emplace(key, Entry{ std::move(border), std::prev(order_.end()) });
+
+	//forget the oldest borders
+	while (order_.size() > capacity_) {
+		borders_.erase(order_.front());
+		order_.pop_front();
+	}
+}
+
+bool ns::Plane::BorderCache::take(const GridPositionType& chunk, unsigned edge, Border& border)
+{
+	std::scoped_lock lock(mutex_);
+
+	auto it = borders_.find(Key{ chunk, edge });
+	if (it == borders_.end()) return false;
+
+	border = std::move(it->second.border);
+	order_.erase(it->second.position);
+	borders_.erase(it);
+	return true;
+}
+
+void ns::Plane::BorderCache::evict(const GridPositionType& center, unsigned distance)
+{
+	std::scoped_lock lock(mutex_);
+
+	for (auto it = borders_.begin(); it != borders_.end();)
+	{
+		const GridPositionType offset = glm::abs(it->first.chunk - center);
+		if (static_cast<unsigned>(std::max(offset.x, offset.y)) > distance) {
+			order_.erase(it->second.position);
+			it = borders_.erase(it);
+		}
+		else
+			++it;
+	}
+}
+
+size_t ns::Plane::BorderCache::size() const
+{
+	std::scoped_lock lock(mutex_);
+	return borders_.size();
+}
+
+unsigned ns::Plane::BorderCache::opposite(unsigned edge)
+{
+	switch (edge)
+	{
+	case bottom: return top;
+	case top: return bottom;
+	case left: return right;
+	default: return left;
+	}
+}
+
+ns::GridPositionType ns::Plane::BorderCache::neighborOffset(unsigned edge)
+{
+	switch (edge)
+	{
+	case bottom: return GridPositionType(0, -1);
+	case top: return GridPositionType(0, 1);
+	case left: return GridPositionType(-1, 0);
+	default: return GridPositionType(1, 0);
+	}
+}
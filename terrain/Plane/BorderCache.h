@@ -0,0 +1,94 @@
+#pragma once
+
+//noisy
+#include <configNoisy.hpp>
+
+//stl
+#include <vector>
+#include <unordered_map>
+#include <list>
+#include <mutex>
+
+namespace ns::Plane {
+	/**
+	 * @brief store the heights of the borders of the chunks that were generated so the neighbor chunks can reuse them
+	 * instead of calling the height map generator again.
+	 * A border is taken (and removed from the cache) by the only chunk that needs it : the one on the other side of the edge.
+	 * The cache is thread safe and forget the oldest borders when it is full.
+	 */
+	class BorderCache
+	{
+	public:
+		//heights of one side of a chunk
+		struct Border {
+			std::vector<HeightType> edge;	//heights on the limit of the chunk
+			std::vector<HeightType> inner;	//heights just before the limit, inside the chunk
+		};
+
+		//edges use the same values as HeightmapStorage::Result neighbors
+		static constexpr unsigned bottom = 0;
+		static constexpr unsigned top = 1;
+		static constexpr unsigned left = 2;
+		static constexpr unsigned right = 3;
+
+		BorderCache(size_t capacity = 4096);
+		/**
+		 * @brief store a border of a chunk
+		 * \param chunk chunk grid position
+		 * \param edge side of the chunk
+		 * \param border heights
+		 */
+		void store(const GridPositionType& chunk, unsigned edge, Border&& border);
+		/**
+		 * @brief search a border and remove it from the cache
+		 * \param chunk chunk grid position
+		 * \param edge side of the chunk
+		 * \param border output
+		 * \return true if the border was in the cache
+		 */
+		bool take(const GridPositionType& chunk, unsigned edge, Border& border);
+		/**
+		 * @brief forget the borders of the chunks that are further than distance chunks from the center
+		 * \param center central chunk
+		 * \param distance distance in chunks (same metric as the render distance)
+		 */
+		void evict(const GridPositionType& center, unsigned distance);
+		/**
+		 * @brief return the number of borders in the cache
+		 */
+		size_t size() const;
+		/**
+		 * @brief return the edge of the neighbor chunk that touches this edge
+		 */
+		static unsigned opposite(unsigned edge);
+		/**
+		 * @brief return the offset between a chunk and the neighbor that touches an edge
+		 */
+		static GridPositionType neighborOffset(unsigned edge);
+
+	protected:
+		struct Key {
+			GridPositionType chunk;
+			unsigned edge;
+
+			bool operator==(const Key& other) const { return chunk == other.chunk and edge == other.edge; }
+		};
+
+		struct KeyHash {
+			size_t operator()(const Key& key) const {
+				return std::hash<int64_t>()(((int64_t)key.chunk.x << 34) ^ ((int64_t)key.chunk.y << 2) ^ key.edge);
+			}
+		};
+
+		//a border and its position in order_, so it can be removed from the order in constant time
+		struct Entry {
+			Border border;
+			std::list<Key>::iterator position;
+		};
+
+		const size_t capacity_;
+		std::unordered_map<Key, Entry, KeyHash> borders_;
+		std::list<Key> order_;		//keys of the borders in the cache from the oldest to the newest, used to forget borders
+		mutable std::mutex mutex_;
+	};
+}
@@ -0,0 +1,75 @@
+#include "ChunkLoadingQueue.h"
+
+//stl
+#include <algorithm>
+
+bool ns::Plane::ChunkLoadingQueue::push(const ChunkRequest& request)
+{
+	std::scoped_lock lock(mutex_);
+
+	if (!registered_.insert(request.position).second) return false;
+
+	heap_.push_back(request);
+	std::push_heap(heap_.begin(), heap_.end(), &compare);
+	return true;
+}
+
+bool ns::Plane::ChunkLoadingQueue::pop(ChunkRequest& request)
+{
+	std::scoped_lock lock(mutex_);
+
+	if (heap_.empty()) return false;
+
+	std::pop_heap(heap_.begin(), heap_.end(), &compare);
+	request = heap_.back();
+	heap_.pop_back();
+	return true;
+}
+
+void ns::Plane::ChunkLoadingQueue::finish(const GridPositionType& position)
+{
+	std::scoped_lock lock(mutex_);
+	registered_.erase(position);
+}
+
+void ns::Plane::ChunkLoadingQueue::reprioritize(const Refresh& refresh)
+{
+	std::scoped_lock lock(mutex_);
+
+	//remove the cancelled requests while updating the others
+	auto end = std::remove_if(heap_.begin(), heap_.end(), [&](ChunkRequest& request) {
+		if (refresh(request)) return false;
+		registered_.erase(request.position);
+		return true;
+	});
+	heap_.erase(end, heap_.end());
+
+	std::make_heap(heap_.begin(), heap_.end(), &compare);
+}
+
+void ns::Plane::ChunkLoadingQueue::clear()
+{
+	std::scoped_lock lock(mutex_);
+
+	for (const auto& request : heap_)
+		registered_.erase(request.position);
+	heap_.clear();
+}
+
+bool ns::Plane::ChunkLoadingQueue::contains(const GridPositionType& position) const
+{
+	std::scoped_lock lock(mutex_);
+	return registered_.count(position);
+}
+
+size_t ns::Plane::ChunkLoadingQueue::size() const
+{
+	std::scoped_lock lock(mutex_);
+	return heap_.size();
+}
+
+bool ns::Plane::ChunkLoadingQueue::compare(const ChunkRequest& a, const ChunkRequest& b)
+{
+	//std heaps put the largest element first
+	return a.priority > b.priority;
+}
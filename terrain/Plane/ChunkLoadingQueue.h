@@ -0,0 +1,87 @@
+#pragma once
+
+//noisy
+#include <configNoisy.hpp>
+#include <terrain/Plane/HeightmapStorage.h>
+
+//stl
+#include <vector>
+#include <unordered_set>
+#include <functional>
+#include <mutex>
+#include <chrono>
+#include <memory>
+
+//glm
+#include <glm/glm.hpp>
+
+namespace ns::Plane {
+	struct ChunkRequest {
+		GridPositionType position;
+		unsigned levelOfDetail = 0;
+		float priority = 0;			//the requests with the smallest priority are loaded first
+		std::chrono::steady_clock::time_point time;	//first request of the chunk, to measure the latency until its upload
+		std::shared_ptr<const HeightmapStorage::Result> heightmap;	//heights of a loaded chunk whose mesh only is rebuilt (null to load the heights)
+	};
+
+	/**
+	 * @brief chunks waiting to be loaded, the loading threads always take the request that has the smallest priority.
+	 * A chunk stays registered from push() to finish(), so it is never queued or loaded twice at the same time,
+	 * and the priorities of the queued requests can be recomputed (or the requests cancelled) when the camera moves.
+	 */
+	class ChunkLoadingQueue
+	{
+	public:
+		//compute the new priority and level of detail of a queued request, return false to cancel it
+		using Refresh = std::function<bool(ChunkRequest&)>;
+
+		/**
+		 * @brief queue a request
+		 * \param request
+		 * \return false if the chunk is already queued or loading
+		 */
+		bool push(const ChunkRequest& request);
+		/**
+		 * @brief take the request with the smallest priority, the chunk stays registered until finish() is called
+		 * \param request receive the request
+		 * \return false if the queue is empty
+		 */
+		bool pop(ChunkRequest& request);
+		/**
+		 * @brief unregister a popped chunk after its loading is finished or cancelled, so it can be requested again
+		 * \param position
+		 */
+		void finish(const GridPositionType& position);
+		/**
+		 * @brief recompute the priorities of all the queued requests
+		 * \param refresh
+		 */
+		void reprioritize(const Refresh& refresh);
+		/**
+		 * @brief cancel all the queued requests (the popped ones stay registered)
+		 */
+		void clear();
+		/**
+		 * @brief return true if the chunk is queued or loading
+		 */
+		bool contains(const GridPositionType& position) const;
+		/**
+		 * @brief return the number of queued requests
+		 */
+		size_t size() const;
+
+	protected:
+		struct PositionHash {
+			size_t operator()(const GridPositionType& position) const {
+				return std::hash<int64_t>()(((int64_t)position.x << 32) ^ (uint32_t)position.y);
+			}
+		};
+
+		std::vector<ChunkRequest> heap_;								//min heap on the priority
+		std::unordered_set<GridPositionType, PositionHash> registered_;	//queued and loading chunks
+		mutable std::mutex mutex_;
+
+	protected:
+		static bool compare(const ChunkRequest& a, const ChunkRequest& b);
+	};
+}
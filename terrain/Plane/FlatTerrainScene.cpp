@@ -1,82 +1,222 @@
 #include "FlatTerrainScene.h"
 #include "configNoisy.hpp"
 
-std::array<std::vector<ns::GridPositionType>, ns::maximunRenderDistance> ns::Plane::FlatTerrainScene::searchingOrder = ns::Plane::FlatTerrainScene::getOrder();
+//stl
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+
+namespace {
+	//size of the staging buffer, enough for a few hundred chunks waiting for their upload
+	constexpr size_t stagingCapacity = 16 << 20;
+}
+
+ns::Plane::FlatTerrainScene::FlatTerrainScene(const Settings& settings, const HeightMapGenerator& function, const std::string& diskCacheDirectory)
+	:
+	FlatTerrainScene(settings, function, LoadingSettings(), diskCacheDirectory, true)
+{}
+
+ns::Plane::FlatTerrainScene::FlatTerrainScene(const Settings& settings, const HeightMapGenerator& function, const LoadingSettings& loading, const std::string& diskCacheDirectory)
+	:
+	FlatTerrainScene(settings, function, loading, diskCacheDirectory, false)
+{}
 
-ns::Plane::FlatTerrainScene::FlatTerrainScene(const Settings& settings, const HeightMapGenerator& function)
+ns::Plane::FlatTerrainScene::FlatTerrainScene(const Settings& settings, const HeightMapGenerator& function, const LoadingSettings& loading, const std::string& diskCacheDirectory, bool usesConfiguration)
 	:
 	settings_(settings),
-	heightStorage_(HeightmapStorage::Settings(function, settings.chunkPhysicalSize, settings.numberOfPartitions)),
+	heightStorage_(HeightmapStorage::Settings(function, settings.chunkPhysicalSize, settings.numberOfPartitions, diskCacheDirectory, settings.quantizationStep)),
 	meshGen_(heightStorage_),
 	numberOfChunks_(0),
-	renderDistance_(8),
-	maxChunksLoadingThreads_(std::max(std::thread::hardware_concurrency(), 1U)),
-	scene_(DirectionalLight::nullLight())
+	renderDistance_(loading.renderDistance),
+	maxChunksLoadingThreads_(loading.maxLoadingThreads ? loading.maxLoadingThreads : std::max(std::thread::hardware_concurrency(), 1U)),
+	levelOfDetailDistance_(loading.levelOfDetailDistance),
+	uploadBudget_(loading.uploadBudget),
+	scene_(DirectionalLight::nullLight()),
+	chunks_(terrainArraySizeNeeded(renderDistance_), GridPositionType(renderDistance_ * -1)),
+	viewpoint_{ MapLengthType(0), MapLengthType(0), 0 },
+	requestedDistance_(0),
+	waitingJobs_(0),
+	usesConfiguration_(usesConfiguration)
 {
-	chunks_ = std::make_unique<BiArray<Chunk>>(terrainArraySizeNeeded(renderDistance_));
-
-	//initialize biarray
 	centralChunk_ = GridPositionType(0);
-	originChunk_ = GridPositionType(renderDistance_ * -1);
 
-	//start searching thread
-	stopAndRestartSearchingThread();
+	//the loading threads write the vertices directly in gpu memory
+	stagingRing_ = std::make_unique<StagingRing>(stagingCapacity);
 
-	importFromYAML();
+	if (usesConfiguration_) importFromYAML();
+	moveChunkArray(centralChunk_);
+
+	//start loading
+	requestChunks(Viewpoint{ settings.chunkPhysicalSize * .5f, MapLengthType(0), 0 }, true);
+	dispatchLoadingJobs();
 }
 
 ns::Plane::FlatTerrainScene::~FlatTerrainScene()
 {
-	//Stop searchingThread if it is running
-	stopSearchingThread_ = true;	//request the thread to stop
+	if (usesConfiguration_) exportIntoYAML();
+
+	//the jobs that didn't start won't find a request, the others use this object so we wait for them
+	loadingQueue_.clear();
+	loadingJobs_.wait();
+}
+
+void ns::Plane::FlatTerrainScene::update(const GridPositionType& centralChunk)
+{
+	const MapLengthType size = settings_.load().chunkPhysicalSize;
+	update(centralChunk, Viewpoint{ size * ((MapLengthType)centralChunk + .5f), MapLengthType(0), 0 });
+}
+
+void ns::Plane::FlatTerrainScene::update(const Camera<>& camera)
+{
+	const auto& position = camera.position();
+	const MapLengthType size = settings_.load().chunkPhysicalSize;
+
+	Viewpoint viewpoint{ MapLengthType(position.x, position.z), MapLengthType(camera.direction().x, camera.direction().z), camera.fov() };
 
-	exportIntoYAML();
+	//the direction is meaningless when the camera look straight down
+	const float directionLength = glm::length(viewpoint.direction);
+	viewpoint.direction = (directionLength > .1f) ? viewpoint.direction / directionLength : MapLengthType(0);
 
-	searchingThread_->join();		//wait for it to stop
+	update(GridPositionType(glm::floor(viewpoint.position / size)), viewpoint);
 }
 
-void ns::Plane::FlatTerrainScene::update(const GridPositionType& centerPosition)
+void ns::Plane::FlatTerrainScene::update(const GridPositionType& centralChunk, const Viewpoint& viewpoint)
 {
 	//check if the chunk loading condition has changed
-	if (centerPosition != centralChunk_.load()) {
-		stopAndRestartSearchingThread();
+	const bool centerChanged = centralChunk != centralChunk_.load() or renderDistance_ != requestedDistance_;
+	if (centerChanged) {
+		centralChunk_ = centralChunk;
+		moveChunkArray(centralChunk);
+		//the borders next to the chunks that are out of range will never be used
+		heightStorage_.evict(centralChunk, renderDistance_ + 1);
 	}
 
-	std::scoped_lock chunksDataLock(chunksDataMutex_);
+	//the priorities are only recomputed when the camera moved enough to change them
+	const MapLengthType size = settings_.load().chunkPhysicalSize;
+	const bool viewpointChanged = glm::length((viewpoint.position - viewpoint_.position) / size) > .25f or
+		(viewpoint.direction != viewpoint_.direction and glm::dot(viewpoint.direction, viewpoint_.direction) < .98f) or viewpoint.fov != viewpoint_.fov;
 
-	if(chunksData_.size())
-		dout << "adding " << chunksData_.size() << " meshes !\n";
+	if (centerChanged or viewpointChanged)
+		requestChunks(viewpoint, centerChanged);
 
-	for (const auto& data : chunksData_)
-	{
-		auto& chunk = getChunk(data.position);
+	dispatchLoadingJobs();
+
+	uploadChunks();
+}
+
+void ns::Plane::FlatTerrainScene::uploadChunks()
+{
+	//give the vectors of the last frames back to the loading threads so the meshing doesn't allocate
+	//(if a loading thread holds the lock they are given at the next frame, the opengl thread never waits)
+	if (uploadedMeshData_.size()) {
+		std::unique_lock recycledLock(recycledMeshDataMutex_, std::try_to_lock);
+		if (recycledLock.owns_lock()) {
+			for (auto& meshData : uploadedMeshData_)
+			{
+				if (recycledMeshData_.size() >= 2 * (size_t)maxChunksLoadingThreads_) break;
+				recycledMeshData_.emplace_back(std::move(meshData));
+			}
+			uploadedMeshData_.clear();
+		}
+	}
 
-		if (chunk.wasProcessed) continue;
-		chunk.position = data.position;
+	//take the chunks loaded since the last frame
+	loadedChunks_.consume([this](ChunkToCreate& data) { pendingUploads_.emplace_back(std::move(data)); });
 
-		MeshConfigInfo info;
-		info.primitive = data.meshData.primitiveType;
-		info.indexedVertices = data.meshData.indexed;
+	if (pendingUploads_.size()) {
+		//the closest chunks are at the end so they are uploaded first
+		std::sort(pendingUploads_.begin(), pendingUploads_.end(), [this](const ChunkToCreate& a, const ChunkToCreate& b) {
+			return priority(a.position) > priority(b.position);
+		});
 
-		chunk.mesh = std::make_shared<ns::Mesh>(data.meshData.vertices, data.meshData.indices, Material::getDefault(), info);
-		chunk.object = std::make_shared<ns::DrawableObject3d<>>(*chunk.mesh);
+		const auto start = std::chrono::steady_clock::now();
+		const std::chrono::duration<float, std::milli> budget(uploadBudget_.load());
+
+		size_t uploads = 0;
+		while (pendingUploads_.size() and (uploads == 0 or std::chrono::steady_clock::now() - start < budget))
+		{
+			ChunkToCreate& data = pendingUploads_.back();
+			if (uploadChunk(data)) uploads++;
 
-		scene_.addStatic(*chunk.object);
-		chunk.wasProcessed = true;
+			uploadedMeshData_.emplace_back(std::move(data.meshData));
+			pendingUploads_.pop_back();
+		}
 	}
 
-	chunksData_.clear();
+	//the staging regions released this frame are reused when the gpu finished the copies
+	if (stagingRing_) stagingRing_->fence();
 }
 
-ns::Scene<>& ns::Plane::FlatTerrainScene::lockScene()
+bool ns::Plane::FlatTerrainScene::uploadChunk(ChunkToCreate& data)
 {
-	sceneMutex_.lock();
-	return scene_;
+	loadingQueue_.finish(data.position);
+
+	//the camera left the chunk behind after its loading, or the chunk already has this level of detail
+	if (!isInRange(data.position) or !chunks_.contains(data.position) or
+		(getChunk(data.position).wasProcessed and getChunk(data.position).levelOfDetail == data.levelOfDetail)) {
+		if (stagingRing_) stagingRing_->release(data.stagedVertices);
+		return false;
+	}
+
+	auto& chunk = getChunk(data.position);
+
+	//the mesh of the previous level of detail is replaced
+	if (chunk.wasProcessed) {
+		if (chunk.object) scene_.removeStatic(*chunk.object);
+		chunk.object.reset();
+		chunk.mesh.reset();
+	}
+	else
+		numberOfChunks_++;
+
+	chunk.position = data.position;
+	chunk.levelOfDetail = data.levelOfDetail;
+	chunk.heightmap = data.heightmap;
+
+	createMesh(chunk, data);
+
+	chunk.wasProcessed = true;
+
+	//the central chunk can move during the loading, the mesh is then rebuilt with the level of its new ring
+	const GridPositionType offset = glm::abs(data.position - centralChunk_.load());
+	const unsigned level = levelOfDetail(std::max(offset.x, offset.y));
+	if (level != data.levelOfDetail)
+		loadingQueue_.push(ChunkRequest{ data.position, level, priority(data.position), std::chrono::steady_clock::now(), chunk.heightmap });
+
+	return true;
 }
 
-void ns::Plane::FlatTerrainScene::unlockScene()
+void ns::Plane::FlatTerrainScene::createMesh(Chunk& chunk, ChunkToCreate& data)
 {
-	sceneMutex_.unlock();
+	MeshConfigInfo info;
+	info.primitive = data.meshData.primitiveType;
+	info.indexedVertices = data.meshData.indexed;
+
+	const auto& vertices = data.meshData.vertices;
+	if (data.stagedVertices) {
+		//the gpu copy the vertices from the staging buffer, the region can be reused once the copy is executed
+		const BufferRange range{ stagingRing_->id(), data.stagedVertices.offset, data.stagedVertices.size };
+		chunk.mesh = std::make_shared<ns::Mesh>(range, meshGen_.vertexLayout(),
+			indexBuffer(data.levelOfDetail, data.meshData.sharedIndices), Material::getDefault(), info);
+		stagingRing_->release(data.stagedVertices);
+	}
+	else if (data.meshData.sharedIndices)
+		chunk.mesh = std::make_shared<ns::Mesh>(vertices.data(), vertices.size() * sizeof(TerrainVertex), meshGen_.vertexLayout(),
+			indexBuffer(data.levelOfDetail, data.meshData.sharedIndices), Material::getDefault(), info);
+	else
+		chunk.mesh = std::make_shared<ns::Mesh>(vertices.data(), vertices.size() * sizeof(TerrainVertex), meshGen_.vertexLayout(),
+			data.meshData.indices, Material::getDefault(), info);
+
+	//the vertices are relative to the chunk origin
+	const MapLengthType origin = meshGen_.chunkOrigin(data.position);
+	chunk.object = std::make_shared<ns::DrawableObject3d<>>(*chunk.mesh, DrawableObject3d<>::vec3p(origin.x, 0, origin.y));
+
+	scene_.addStatic(*chunk.object);
+}
+
+const ns::Scene<>& ns::Plane::FlatTerrainScene::scene() const
+{
+	return scene_;
 }
 
 void ns::Plane::FlatTerrainScene::setRenderDistance(uint16_t renderDistance)
@@ -89,6 +229,16 @@ void ns::Plane::FlatTerrainScene::setMaxOfLoadingThreads(uint16_t maxThreads)
 	maxChunksLoadingThreads_ = maxThreads;
 }
 
+void ns::Plane::FlatTerrainScene::setLevelOfDetailDistance(uint16_t distance)
+{
+	levelOfDetailDistance_ = distance;
+}
+
+void ns::Plane::FlatTerrainScene::setUploadBudget(float milliseconds)
+{
+	uploadBudget_ = milliseconds;
+}
+
 uint16_t ns::Plane::FlatTerrainScene::renderDistance() const
 {
 	return renderDistance_.load();
@@ -99,11 +249,28 @@ uint16_t ns::Plane::FlatTerrainScene::maxLoadingThreads() const
 	return maxChunksLoadingThreads_.load();
 }
 
+uint16_t ns::Plane::FlatTerrainScene::levelOfDetailDistance() const
+{
+	return levelOfDetailDistance_.load();
+}
+
+float ns::Plane::FlatTerrainScene::uploadBudget() const
+{
+	return uploadBudget_.load();
+}
+
+uint32_t ns::Plane::FlatTerrainScene::numberOfLoadedChunks() const
+{
+	return numberOfChunks_.load();
+}
+
 void ns::Plane::FlatTerrainScene::importFromYAML()
 {
 	try {
 		renderDistance_ = conf["planeTerrain"]["renderdistance"].as<int>();
 		maxChunksLoadingThreads_ = conf["planeTerrain"]["maxThreads"].as<int>();
+		levelOfDetailDistance_ = conf["planeTerrain"]["lodDistance"].as<int>();
+		uploadBudget_ = conf["planeTerrain"]["uploadBudget"].as<float>();
 	}
 	catch (...) {
 
@@ -114,18 +281,8 @@ void ns::Plane::FlatTerrainScene::exportIntoYAML()
 {
 	conf["planeTerrain"]["renderdistance"] = renderDistance_.load();
 	conf["planeTerrain"]["maxThreads"] = maxChunksLoadingThreads_.load();
-}
-
-void ns::Plane::FlatTerrainScene::checkRenderDistanceCapacity()
-{
-	const glm::ivec2 minSize = terrainArraySizeNeeded(renderDistance_);
-	
-	if (chunks_->x() < minSize.x or chunks_->y() < minSize.y) {
-		const BiArray<Chunk> copy(*chunks_);
-	
-		chunks_ = std::make_unique<BiArray<Chunk>>(minSize);
-		*chunks_ = copy;
-	}
+	conf["planeTerrain"]["lodDistance"] = levelOfDetailDistance_.load();
+	conf["planeTerrain"]["uploadBudget"] = uploadBudget_.load();
 }
 
 glm::ivec2 ns::Plane::FlatTerrainScene::terrainArraySizeNeeded(unsigned renderDistance)
@@ -133,124 +290,191 @@ glm::ivec2 ns::Plane::FlatTerrainScene::terrainArraySizeNeeded(unsigned renderDi
 	return glm::ivec2(renderDistance) * 2 + glm::ivec2(1);
 }
 
-void ns::Plane::FlatTerrainScene::searchingThreadFunction(FlatTerrainScene* ptr)
+void ns::Plane::FlatTerrainScene::requestChunks(const Viewpoint& viewpoint, bool centerChanged)
 {
-	dout << "started searching...\n";
-	FlatTerrainScene& object = *ptr;
-	for (unsigned dst = 0; dst <= object.renderDistance_; ++dst)
+	viewpoint_ = viewpoint;
+	requestedDistance_ = renderDistance_;
+
+	//cancel the queued requests that are out of range and update the others
+	const GridPositionType center = centralChunk_.load();
+	loadingQueue_.reprioritize([&](ChunkRequest& request) {
+		if (!isInRange(request.position)) return false;
+
+		const GridPositionType offset = glm::abs(request.position - center);
+		request.levelOfDetail = levelOfDetail(std::max(offset.x, offset.y));
+		request.priority = priority(request.position);
+		return true;
+	});
+
+	if (!centerChanged) return;
+
+	//request the chunks that are not loaded or whose level of detail changed, the queue ignores the ones that are already queued or loading
+	const auto now = std::chrono::steady_clock::now();
+	const unsigned distance = std::min<unsigned>(renderDistance_, SquareSpiral::rings - 1);
+	for (unsigned dst = 0; dst <= distance; ++dst)
 	{
-		for (size_t i = 0; i < searchingOrder[dst].size(); i++)
+		for (const GridPositionType& offset : SquareSpiral::ring(dst))
 		{
-			
-			//check if this thread receive a close request
-			if (object.stopSearchingThread_.load()) return;
+			const GridPositionType chunkPos = center + offset;
+			if (!chunks_.contains(chunkPos)) continue;
 
-			{
-				std::scoped_lock lock(object.loadingFuturesMutex_);
+			//the mesh of a loaded chunk is rebuilt from its heights when its ring uses another level of detail
+			const unsigned level = levelOfDetail(dst);
+			const Chunk& chunk = getChunk(chunkPos);
+			if (chunk.wasProcessed and chunk.levelOfDetail == level) continue;
 
-				//wait until the number of loading threads in less than the fixed limit
-				if (object.loadingFutures_.size() >= object.maxChunksLoadingThreads_) {
-					object.loadingFutures_.erase(object.loadingFutures_.begin()); //wait for the oldest thread to finish by calling his future's destructor
-				}
-			}
+			loadingQueue_.push(ChunkRequest{ chunkPos, level, priority(chunkPos), now, chunk.heightmap });
+		}
+	}
+}
 
-			const GridPositionType& chunkPos = searchingOrder[dst][i];
-			Chunk& chunk = object.getChunk(chunkPos);
+void ns::Plane::FlatTerrainScene::dispatchLoadingJobs()
+{
+	//the jobs take the best request when they start, so the priorities can still change while they wait in the job system
+	while (waitingJobs_.load() < loadingQueue_.size() and loadingJobs_.pending() < maxChunksLoadingThreads_.load())
+	{
+		waitingJobs_++;
+		JobSystem::get().submit([this]() { loadingThreadFunction(this); }, JobSystem::Priority::normal, &loadingJobs_);
+	}
+}
 
-			//if the chunk was already loaded or is currently loading
-			if (chunk.wasProcessed) continue;
+float ns::Plane::FlatTerrainScene::priority(const GridPositionType& chunk) const
+{
+	//distance in chunks between the viewpoint and the center of the chunk
+	const MapLengthType size = settings_.load().chunkPhysicalSize;
+	const MapLengthType toChunk = (size * ((MapLengthType)chunk + .5f) - viewpoint_.position) / size;
+	const float distance = glm::length(toChunk);
 
-			std::scoped_lock lock(object.loadingFuturesMutex_);
+	//the chunks around the camera are always needed first
+	if (distance < 1.5f or viewpoint_.direction == MapLengthType(0)) return distance;
 
-			//launch loading thread
-			object.loadingFutures_.emplace_back(std::async(std::launch::async, &loadingThreadFunction, &object, chunkPos));
-		}
-	}
+	//the horizontal half angle of the field of view is under the vertical fov for the usual aspect ratios
+	const float angle = std::acos(glm::clamp(glm::dot(toChunk / distance, viewpoint_.direction), -1.f, 1.f));
+	const float margin = std::asin(std::min(.71f / distance, 1.f));	//half of the chunk diagonal
+
+	//the chunks outside of the field of view are loaded after the visible ones that are up to 3 times further
+	return (angle <= viewpoint_.fov + margin) ? distance : distance * 3;
 }
 
-void ns::Plane::FlatTerrainScene::loadingThreadFunction(FlatTerrainScene* object, ns::GridPositionType chunk)
+bool ns::Plane::FlatTerrainScene::isInRange(const GridPositionType& chunk) const
 {
-	dout << "loading chunk " << to_string(chunk) << '\n';
+	const GridPositionType offset = glm::abs(chunk - centralChunk_.load());
+	return static_cast<unsigned>(std::max(offset.x, offset.y)) <= renderDistance_.load();
+}
+
+void ns::Plane::FlatTerrainScene::loadingThreadFunction(FlatTerrainScene* object)
+{
+	object->waitingJobs_--;
+
+	ChunkRequest request;
+	if (!object->loadingQueue_.pop(request)) return;
+
+	//the chunk is unregistered on every exit (cancellation or exception) except when its result is given to uploadChunk()
+	struct FinishGuard {
+		ChunkLoadingQueue& queue;
+		const GridPositionType& position;
+		bool handedOver = false;
+		~FinishGuard() { if (!handedOver) queue.finish(position); }
+	} finishGuard{ object->loadingQueue_, request.position };
+
+	//the camera can leave the chunk behind at any step of the loading
+	auto cancelled = [&]() { return !object->isInRange(request.position); };
+
+	if (cancelled()) return;
+
+	const auto start = std::chrono::steady_clock::now();
+
 	ChunkToCreate ret;
-	ret.position = chunk;
-	auto heightmap = object->heightStorage_(chunk);
+	ret.position = request.position;
+	ret.levelOfDetail = request.levelOfDetail;
+	ret.requestTime = request.time;
 
-	object->meshGen_(*heightmap, ret.meshData);
+	//a level of detail change only rebuilds the mesh from the heights of the loaded chunk
+	ret.remeshed = request.heightmap != nullptr;
+	ret.heightmap = ret.remeshed ? request.heightmap : object->heightStorage_(request.position);
+	const auto& heightmap = ret.heightmap;
 
-	std::scoped_lock chunkDataProtection(object->chunksDataMutex_);
-	object->chunksData_.emplace_back(ret);
+	if (cancelled()) return;
+
+	{
+		std::scoped_lock recycledLock(object->recycledMeshDataMutex_);
+		if (object->recycledMeshData_.size()) {
+			ret.meshData = std::move(object->recycledMeshData_.back());
+			object->recycledMeshData_.pop_back();
+		}
+	}
+
+	object->meshGen_(*heightmap, ret.meshData, request.levelOfDetail);
+
+	//write the vertices in the staging buffer so the opengl thread only has to ask a gpu copy (the meshes that don't share their indices are uploaded from the cpu)
+	const auto& vertices = ret.meshData.vertices;
+	if (object->stagingRing_ and ret.meshData.sharedIndices) {
+		ret.stagedVertices = object->stagingRing_->allocate(vertices.size() * sizeof(TerrainVertex));
+		if (ret.stagedVertices)
+			std::memcpy(ret.stagedVertices.data, vertices.data(), ret.stagedVertices.size);
+	}
+
+	ret.loadingTime = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+	object->loadedChunks_.push(std::move(ret));
+	finishGuard.handedOver = true;
 }
 
-void ns::Plane::FlatTerrainScene::moveChunkArray(const GridPositionType& newCentralChunk)
+const std::shared_ptr<const ns::IndexBuffer>& ns::Plane::FlatTerrainScene::indexBuffer(unsigned levelOfDetail, const std::shared_ptr<const std::vector<unsigned>>& indices)
 {
-	ns::BiArray<Chunk> copy(*chunks_);
+	//the mesh generator clamps the level, so the levels above the last one have the same topology
+	levelOfDetail = std::min(levelOfDetail, meshGen_.numberOfLevels() - 1);
+	if (indexBuffers_.size() <= levelOfDetail)
+		indexBuffers_.resize((size_t)levelOfDetail + 1);
 
+	//upload the topology the first time a chunk of this level is created
+	auto& ret = indexBuffers_[levelOfDetail];
+	if (!ret)
+		ret = std::make_shared<IndexBuffer>(*indices);
 
+	return ret;
 }
 
-void ns::Plane::FlatTerrainScene::stopAndRestartSearchingThread()
+unsigned ns::Plane::FlatTerrainScene::levelOfDetail(unsigned ring) const
 {
-	//check that the a thread object was created
-	if (searchingThread_.get() != nullptr) {
-
-		stopSearchingThread_ = true;	//request the thread to stop
-		searchingThread_->join();		//wait for it to stop
-		stopSearchingThread_ = false;	//remove the stop request for the next thread
-	}
+	const unsigned distance = levelOfDetailDistance_.load();
+	if (distance == 0) return 0;
 
+	//the level increase by one every time the ring distance double, so two neighbor chunks are never more than one level apart
+	unsigned level = 0;
+	while (ring >= distance << level) level++;
 
-	//create or recreate the thread object
-	searchingThread_ = std::make_unique<std::thread>(&searchingThreadFunction, this);
+	return std::min(level, meshGen_.numberOfLevels() - 1);
 }
 
-ns::Plane::FlatTerrainScene::Chunk& ns::Plane::FlatTerrainScene::getChunk(const GridPositionType& gridPos)
+void ns::Plane::FlatTerrainScene::moveChunkArray(const GridPositionType& newCentralChunk)
 {
-	GridPositionType location = gridPos - originChunk_.load();
-	return chunks_->value(location.x, location.y);
+	const glm::ivec2 size = terrainArraySizeNeeded(renderDistance_);
+	const GridPositionType origin = newCentralChunk - GridPositionType(renderDistance_);
+
+	auto unload = [this](Chunk& chunk) { unloadChunk(chunk); };
+
+	//the array is only reallocated when the render distance changes
+	if (size != chunks_.size())
+		chunks_.resize(size, origin, unload);
+	else
+		chunks_.move(origin, unload);
 }
 
-std::array<std::vector<ns::GridPositionType>, ns::maximunRenderDistance> ns::Plane::FlatTerrainScene::getOrder()
+void ns::Plane::FlatTerrainScene::unloadChunk(Chunk& chunk)
 {
-	//(dst, dst) / (-1, 0) * dst * 2 / (0, -1) * dst * 2 / (1, 0) * dst * 2 / (0, 1) * (dst * 2 - 1)
-	std::array<std::vector<ns::GridPositionType>, maximunRenderDistance> ret;
-
-	//central chunk offset is of course null
-	ret[0].push_back(GridPositionType(0, 0));
+	if (!chunk.wasProcessed) return;
 
-	for (size_t dst = 1; dst < maximunRenderDistance; dst++)
-	{
-		std::vector<ns::GridPositionType>& circle = ret[dst];
-		circle.resize(8 * dst);
+	if (chunk.object) scene_.removeStatic(*chunk.object);
+	numberOfChunks_--;
 
-		//start by the chunk that is at ivec2(dst, dst)
-		circle[0] = GridPositionType(static_cast<int>(dst));
-		unsigned cursor = 1;
+	//the gpu buffers are deleted with the mesh (the index buffer is shared by the other chunks of the same level)
+	chunk.object.reset();
+	chunk.mesh.reset();
+	chunk.heightmap.reset();
+	chunk.wasProcessed = false;
+}
 
-		//then go to the top-left corner
-		for (size_t i = 0; i < dst * 2; i++)
-		{
-			circle[cursor] = circle[cursor - 1] + GridPositionType(-1, 0);
-			cursor++;
-		}
-		//then to the bottom-left corner
-		for (size_t i = 0; i < dst * 2; i++)
-		{
-			circle[cursor] = circle[cursor - 1] + GridPositionType(0, -1);
-			cursor++;
-		}
-		//then to the bottom-right corner
-		for (size_t i = 0; i < dst * 2; i++)
-		{
-			circle[cursor] = circle[cursor - 1] + GridPositionType(1, 0);
-			cursor++;
-		}
-		//then just under the start at ivec2(dst, dst - 1)
-		for (size_t i = 0; i < dst * 2 - 1; i++)
-		{
-			circle[cursor] = circle[cursor - 1] + GridPositionType(0, 1);
-			cursor++;
-		}
-		//and all the chunks in the square that has a size of dst * 2 + 1 are in the array at the index dst
-	}
-	return ret;
+ns::Plane::FlatTerrainScene::Chunk& ns::Plane::FlatTerrainScene::getChunk(const GridPositionType& gridPos)
+{
+	return chunks_.value(gridPos);
 }
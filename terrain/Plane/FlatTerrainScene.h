@@ -1,49 +1,67 @@
 #pragma once
 #include <Rendering/Camera.h>
+#include <Rendering/StagingRing.h>
 #include <thread>
-#include <future>
 #include <atomic>
 #include <mutex>
+#include <chrono>
 #include "HeightmapStorage.h"
 #include "MeshGenerator.h"
-#include <Utils/BiArray.h>
+#include "ChunkLoadingQueue.h"
+#include <Utils/ToroidalArray.h>
+#include <Utils/JobSystem.h>
+#include <Utils/MpscQueue.h>
+#include <Utils/SpiralOrder.h>
 
 namespace ns::Plane{
 	/**
 	 * @brief organize a collection of meshes that create a flat terrain
 	 * meshes are created by another class, rendering is made by another class 
 	 * plan : 
-	 * run all on a secondary thread and launch some threads to load chunks until number of loading threads hit a fixed limit
-	 * if all the chunks are loaded, end the thread, then the update function check that the central chunk is unedited and that the loading 
-	 * settings are still the same, else, the update function launch the searching thread.
-	 * the searching thread work by using some precomputed values that turn around the central chunk to search a new chunk to load 
-	 * we need to know for each chunk grid pos if the chunk is loaded or in loading or if it is not loaded at all 
+	 * when the central chunk changes, the update function uses some precomputed values that turn around the central chunk to request
+	 * the chunks that are not loaded in a priority queue (the closest to the camera and the ones in the field of view first).
+	 * the loading jobs of the engine job system take the best request when they start, so when the camera moves the priorities are
+	 * only recomputed, and the requests of the chunks that leave the render distance are cancelled (even during their loading).
+	 * the loading jobs write the vertices in a staging buffer that stays mapped, then the update function create the meshes of the
+	 * loaded chunks where the opengl context is, the closest first and only during a fixed time per frame
 	 * 
 	 */
 	class FlatTerrainScene
 	{
 	public:
 		struct Settings {
-			Settings(MapLengthType size, ChunkPartitionType parts) : chunkPhysicalSize(size), numberOfPartitions(parts) {}
+			Settings(MapLengthType size, ChunkPartitionType parts, HeightType quantization = 0) : chunkPhysicalSize(size), numberOfPartitions(parts), quantizationStep(quantization) {}
 			Settings(const HeightmapStorage::Settings& settings) : 
-				Settings(settings.chunkPhysicalSize, settings.numberOfPartitions)
+				Settings(settings.chunkPhysicalSize, settings.numberOfPartitions, settings.quantizationStep)
 			{}
 			MapLengthType chunkPhysicalSize = MapLengthType(16.0);
 			ChunkPartitionType numberOfPartitions = ns::defaultSize;
+			HeightType quantizationStep = 0;	//store the heights of the chunks in 16 bits with this precision (0 to disable)
 		};
-		FlatTerrainScene(const Settings& settings, const HeightMapGenerator& function);
-		~FlatTerrainScene();
+		//the heights are saved in diskCacheDirectory and read back by the next scenes (no disk cache if it is empty)
+		FlatTerrainScene(const Settings& settings, const HeightMapGenerator& function, const std::string& diskCacheDirectory = "");
+		virtual ~FlatTerrainScene();
 
+		//load the chunks around the central chunk, the closest first
 		void update(const GridPositionType& centralChunk);
+		//load the chunks around the camera, the closest first and the ones in the field of view before the others
+		void update(const Camera<>& camera);
 
-		Scene<>& lockScene();
-		void unlockScene();
+		//the scene is only modified by update(), so it can be used without lock on the thread that calls update()
+		const Scene<>& scene() const;
 
 		void setRenderDistance(uint16_t renderDistance);
 		void setMaxOfLoadingThreads(uint16_t maxThreads);
+		//number of rings around the central chunk that use the full resolution, the level of detail then drop every time the distance double (0 to disable the levels of detail)
+		void setLevelOfDetailDistance(uint16_t distance);
+		//time that update() can spend to create the meshes of the loaded chunks each frame (at least one mesh is created per frame)
+		void setUploadBudget(float milliseconds);
 
 		uint16_t renderDistance() const;
 		uint16_t maxLoadingThreads() const;
+		uint16_t levelOfDetailDistance() const;
+		float uploadBudget() const;
+		uint32_t numberOfLoadedChunks() const;
 
 		void importFromYAML();
 		void exportIntoYAML();
@@ -53,17 +71,27 @@ namespace ns::Plane{
 		//dynamic settings
 		std::atomic_uint16_t renderDistance_;
 		std::atomic_uint16_t maxChunksLoadingThreads_;
+		std::atomic_uint16_t levelOfDetailDistance_;
+		std::atomic<float> uploadBudget_;	//in milliseconds
 
 		struct Chunk {
 			std::shared_ptr<Mesh> mesh;					//chunk mesh
 			std::shared_ptr<DrawableObject3d<>> object;	//chunk object
 			GridPositionType position;					//position on a grid plane 
+			unsigned levelOfDetail = 0;					//level of detail of the mesh
+			std::shared_ptr<const HeightmapStorage::Result> heightmap;	//heights of the mesh, reused when the level of detail changes
 			bool wasProcessed = false;					//indicate if the chunk is loaded or currently in loading
 		};
 
 		struct ChunkToCreate {
 			ns::GridPositionType position;
+			unsigned levelOfDetail;
 			MeshGenerator::Result meshData;
+			std::shared_ptr<const HeightmapStorage::Result> heightmap;	//heights used by the mesh
+			bool remeshed = false;				//true if the heights came from the loaded chunk and only the mesh was generated
+			StagingRing::Region stagedVertices;	//copy of the vertices in the staging buffer (empty if it was full)
+			float loadingTime = 0;				//time spent by the loading job in milliseconds
+			std::chrono::steady_clock::time_point requestTime;	//time of the request of the chunk
 		};
 
 		std::atomic<Settings> settings_;
@@ -74,42 +102,90 @@ namespace ns::Plane{
 
 		//data storage
 		Scene<> scene_;
-		std::mutex sceneMutex_;
 
-		std::vector<ChunkToCreate> chunksData_;
-		std::mutex chunksDataMutex_;
+		MpscQueue<ChunkToCreate> loadedChunks_;					//chunks given by the loading threads to update() without lock
+		std::vector<MeshGenerator::Result> recycledMeshData_;	//uploaded meshes whose vectors are reused by the loading threads
+		std::mutex recycledMeshDataMutex_;
 
-		std::unique_ptr<BiArray<Chunk>> chunks_;
+		std::vector<ChunkToCreate> pendingUploads_;			//loaded chunks that wait for their upload (only used by update())
+		std::vector<MeshGenerator::Result> uploadedMeshData_;	//mesh data of this frame uploads, recycled at the next frame (only used by update())
+		std::unique_ptr<StagingRing> stagingRing_;			//vertices written by the loading threads for the gpu
+
+		ToroidalArray<Chunk> chunks_;	//chunks within the render distance of the central chunk, it follows the central chunk without moving them
+		std::vector<std::shared_ptr<const IndexBuffer>> indexBuffers_;	//index buffer of each level of detail, shared by all the chunk meshes
 		std::atomic_uint32_t numberOfChunks_;
 
 		//chunks loading
 		std::atomic<GridPositionType> centralChunk_;//store the central chunk grid position
-		std::atomic<GridPositionType> originChunk_;//store the first chunk position of the array of chunks
 
-		std::unique_ptr<std::thread> searchingThread_; //thread that search for new chunk to load
-		std::atomic_bool stopSearchingThread_;
+		//camera used to compute the priorities, on the map plane
+		struct Viewpoint {
+			MapLengthType position;
+			MapLengthType direction;	//normalized, null to only use the distance
+			float fov;
+		};
+		Viewpoint viewpoint_;				//viewpoint of the last priorities (only used by update())
+		uint16_t requestedDistance_;		//render distance of the last requests (only used by update())
 
-		std::vector<std::future<void>> loadingFutures_;
-		std::mutex loadingFuturesMutex_;
+		ChunkLoadingQueue loadingQueue_;	//chunks to load, ordered by priority
+		JobCounter loadingJobs_;			//loading jobs queued or running in the engine job system
+		std::atomic_uint32_t waitingJobs_;	//loading jobs that didn't take a request yet
 
-	protected:
-		void checkRenderDistanceCapacity();
-		static glm::ivec2 terrainArraySizeNeeded(unsigned renderDistance);
+		bool usesConfiguration_;	//the dynamic settings are imported from and exported into the configuration file
 
-		static void searchingThreadFunction(FlatTerrainScene* object);
-		static void loadingThreadFunction(FlatTerrainScene* object, ns::GridPositionType chunk);
+	protected:
+		//dynamic settings of a terrain that doesn't use the configuration file
+		struct LoadingSettings {
+			uint16_t renderDistance = 8;
+			uint16_t maxLoadingThreads = 0;		//0 for the number of hardware threads
+			uint16_t levelOfDetailDistance = 4;
+			float uploadBudget = 2.f;			//in milliseconds
+		};
+		/**
+		 * @brief create a terrain whose dynamic settings are given instead of imported from the configuration file,
+		 * and are not exported into it by the destructor (a benchmark must not change the settings of the application)
+		 * \param settings
+		 * \param function
+		 * \param loading
+		 * \param diskCacheDirectory
+		 */
+		FlatTerrainScene(const Settings& settings, const HeightMapGenerator& function, const LoadingSettings& loading, const std::string& diskCacheDirectory = "");
 
+		static glm::ivec2 terrainArraySizeNeeded(unsigned renderDistance);
 
+		void update(const GridPositionType& centralChunk, const Viewpoint& viewpoint);
+		//request the chunks around the central chunk that are not loaded or use another level of detail, and recompute the priorities of the queued ones
+		void requestChunks(const Viewpoint& viewpoint, bool centerChanged);
+		//submit loading jobs until there is one per queued request or the limit of loading threads is hit
+		void dispatchLoadingJobs();
+		//priority of a chunk for the current viewpoint (the smallest is loaded first)
+		float priority(const GridPositionType& chunk) const;
+		//check that the chunk is within the render distance of the central chunk
+		bool isInRange(const GridPositionType& chunk) const;
+
+		//create the meshes of the loaded chunks until the upload budget of the frame is spent
+		void uploadChunks();
+		//create the mesh of a loaded chunk or replace the one of its previous level of detail, return false if the chunk isn't needed anymore
+		bool uploadChunk(ChunkToCreate& data);
+		//create the opengl mesh and the object of a chunk and add it to the scene (overridden to use the terrain without opengl)
+		virtual void createMesh(Chunk& chunk, ChunkToCreate& data);
+
+		static void loadingThreadFunction(FlatTerrainScene* object);
+		//return the index buffer of a level of detail and create it if it doesn't exist (only called by update() where the opengl context is)
+		const std::shared_ptr<const IndexBuffer>& indexBuffer(unsigned levelOfDetail, const std::shared_ptr<const std::vector<unsigned>>& indices);
+		//level of detail of the chunks of a ring of the spiral order
+		unsigned levelOfDetail(unsigned ring) const;
+
+
+		//center the array of chunks on a chunk and fit it to the render distance, the chunks that leave it are unloaded
 		void moveChunkArray(const GridPositionType& newCentralChunk);
-		//this function check if the searching is already running and stop it to restart it from the beginning
-		void stopAndRestartSearchingThread();
+		//remove the chunk from the scene and release its mesh
+		void unloadChunk(Chunk& chunk);
 
 		Chunk& getChunk(const GridPositionType& gridPos);
 
-	public:
-		//store a list of grid position that allow to check all the chunks near one central chunk one by one by iterating through those arrays
-		static std::array<std::vector<ns::GridPositionType>, maximunRenderDistance> getOrder();			//create the arrays
-		static std::array<std::vector<ns::GridPositionType>, maximunRenderDistance> searchingOrder;		//store the arrays
+	private:
+		FlatTerrainScene(const Settings& settings, const HeightMapGenerator& function, const LoadingSettings& loading, const std::string& diskCacheDirectory, bool usesConfiguration);
 	};
 }
 
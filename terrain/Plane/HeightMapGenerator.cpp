@@ -1,13 +1,18 @@
 #include "HeightMapGenerator.h"
 #include "gcem.hpp"
+#include <Utils/SimdLanes.h>
+
+//stl
+#include <chrono>
+#include <cmath>
 
 ns::Plane::HeightMapGenerator::HeightMapGenerator(const Settings& settings)
 	:
 	settings_(settings)
 {
-#		ifndef NDEBUG
-		numberOfComputation_ = 0;
-#		endif // !NDEBUG
+#		if NS_TERRAIN_STATISTICS
+		counters_ = std::make_shared<ShardedCounter<numberOfCounters>>();
+#		endif // NS_TERRAIN_STATISTICS
 
 		inversedAmplitudeRect_ = 0;
 		for (const auto& octave : settings_.octaves) {
@@ -17,6 +22,13 @@ ns::Plane::HeightMapGenerator::HeightMapGenerator(const Settings& settings)
 		inversedAmplitudeRect_ = 1 / inversedAmplitudeRect_;
 }
 
+ns::Plane::HeightMapGenerator::HeightMapGenerator(const std::shared_ptr<const Evaluator>& evaluator)
+	:
+	HeightMapGenerator(evaluator->settings())
+{
+	evaluator_ = evaluator;
+}
+
 const ns::Plane::HeightMapGenerator::Settings& ns::Plane::HeightMapGenerator::settings() const
 {
 	return settings_;
@@ -24,10 +36,23 @@ const ns::Plane::HeightMapGenerator::Settings& ns::Plane::HeightMapGenerator::se
 
 ns::HeightType ns::Plane::HeightMapGenerator::operator()(const ns::MapLengthType& pos) const
 {
-#		ifndef NDEBUG
-		numberOfComputation_++;
-#		endif // !NDEBUG
+#		if NS_TERRAIN_STATISTICS
+		counters_->add(samplesCounter, 1);
+		counters_->add(octavesCounter, settings_.octaves.size());
+#		endif // NS_TERRAIN_STATISTICS
+
+	return computeSample(pos);
+}
+
+ns::HeightType ns::Plane::HeightMapGenerator::computeSample(const MapLengthType& pos) const
+{
+	if (evaluator_) return (*evaluator_)(pos);
+
+	return computeSettingsSample(pos);
+}
 
+ns::HeightType ns::Plane::HeightMapGenerator::computeSettingsSample(const MapLengthType& pos) const
+{
 	HeightType ret = 0;
 
 	for (const auto& octave : settings_.octaves) {
@@ -42,14 +67,102 @@ ns::HeightType ns::Plane::HeightMapGenerator::operator()(const ns::MapLengthType
 	return pow(ret, settings_.exponent);
 }
 
-#ifndef NDEBUG
+void ns::Plane::HeightMapGenerator::operator()(const MapLengthType& start, const MapLengthType& step, size_t count, HeightType* output) const
+{
+#		if NS_TERRAIN_STATISTICS
+		const auto begin = std::chrono::steady_clock::now();
+#		endif // NS_TERRAIN_STATISTICS
+
+	computeBatch(start, step, count, output);
+
+#		if NS_TERRAIN_STATISTICS
+		const auto duration = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin);
+		counters_->add(samplesCounter, count);
+		counters_->add(octavesCounter, count * settings_.octaves.size());
+		counters_->add(nanosecondsCounter, duration.count());
+#		endif // NS_TERRAIN_STATISTICS
+
+#	ifndef NDEBUG
+	//the first sample is computed by the SIMD lanes and the last one often by the scalar tail, both must match the scalar function
+	//of the settings, which also checks that an evaluator computes the generator it describes
+	//(the comparison is written to accept NaN on both sides, when a negative sum has a fractional exponent)
+	if (count) {
+		_STL_ASSERT(!(std::abs(output[0] - computeSettingsSample(start)) > batchTolerance), "the batched heights differ from the scalar function");
+		_STL_ASSERT(!(std::abs(output[count - 1] - computeSettingsSample(start + step * (LengthType)(count - 1))) > batchTolerance), "the batched heights differ from the scalar function");
+	}
+#	endif // !NDEBUG
+}
+
+void ns::Plane::HeightMapGenerator::computeBatch(const MapLengthType& start, const MapLengthType& step, size_t count, HeightType* output) const
+{
+	if (evaluator_) return (*evaluator_)(start, step, count, output);
+
+	//buffers are kept by each thread to avoid allocations between two rows
+	thread_local std::vector<LengthType> xs, ys;
+	thread_local std::vector<HeightType> noise;
+	xs.resize(count);
+	ys.resize(count);
+	noise.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+		output[i] = 0;
+
+	for (const auto& octave : settings_.octaves) {
+		for (size_t i = 0; i < count; i++)
+		{
+			xs[i] = (start.x + i * step.x) * octave.frequency + octave.offset;
+			ys[i] = (start.y + i * step.y) * octave.frequency + octave.offset;
+		}
+
+		if (octave.ridged)
+			ridgedSimplexNoise(xs.data(), ys.data(), count, noise.data());
+		else
+			simplexNoise(xs.data(), ys.data(), count, noise.data());
+
+		for (size_t i = 0; i < count; i++)
+			output[i] += noise[i] * octave.amplitude;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		output[i] *= inversedAmplitudeRect_;
+
+	if (settings_.exponent == 1.0) return;
+
+	for (size_t i = 0; i < count; i++)
+		output[i] = static_cast<HeightType>(pow(output[i], settings_.exponent));
+}
+
+void ns::Plane::HeightMapGenerator::operator()(const MapLengthType& origin, const MapLengthType& step, BiArray<HeightType>& output) const
+{
+	//rows are contiguous in a biarray so each row is computed in one batch
+	for (uint32_t j = 0; j < output.y(); j++)
+	{
+		(*this)(MapLengthType(origin.x, origin.y + j * step.y), MapLengthType(step.x, 0), output.x(), &output.value(0, j));
+	}
+}
+
+#if NS_TERRAIN_STATISTICS
+
+ns::Plane::HeightMapGenerator::Statistics ns::Plane::HeightMapGenerator::statistics() const
+{
+	Statistics ret;
+	ret.samples = counters_->total(samplesCounter);
+	ret.octaves = counters_->total(octavesCounter);
+	ret.seconds = static_cast<double>(counters_->total(nanosecondsCounter)) * 1e-9;
+	return ret;
+}
+
+void ns::Plane::HeightMapGenerator::resetStatistics()
+{
+	counters_->reset();
+}
 
 size_t ns::Plane::HeightMapGenerator::callCounter() const
 {
-	return numberOfComputation_;
+	return counters_->total(samplesCounter);
 }
 
-#endif // !NDEBUG
+#endif // NS_TERRAIN_STATISTICS
 
 
 //SIMPLEX NOISE
@@ -163,3 +276,118 @@ ns::HeightType ns::Plane::ridgedSimplexNoise(const MapLengthType& location)
 {
 	return 2.0_ht * (abs(0.5_ht - simplexNoise(location)));
 }
+
+
+//BATCHED SIMPLEX NOISE
+//
+//the same algorithm as simplexNoise() but written with lanes wrappers so each call compute several values
+
+namespace {
+	//components of grad3 split in two arrays so they can be loaded lane by lane
+	constexpr float gradX[12] = { 1, -1, 1, -1, 1, -1, 1, -1, 0, 0, 0, 0 };
+	constexpr float gradY[12] = { 1, 1, -1, -1, 0, 0, 0, 0, 1, -1, 1, -1 };
+
+	//perm[i] % 12 because there is no integer modulo in the simd instruction sets
+	const std::array<int, 512> permMod12 = []() {
+		std::array<int, 512> ret{};
+		for (size_t i = 0; i < ret.size(); i++)
+			ret[i] = perm[i] % 12;
+		return ret;
+	}();
+
+#ifdef NS_SIMD_LANES
+	using ns::simd::Lanes;
+#endif
+
+#ifdef NS_SIMD_LANES
+	//same behavior as ns::Plane::fastfloor() : (x > 0) ? int(x) : int(x - 1)
+	inline Lanes::I fastfloor(Lanes::F x)
+	{
+		return Lanes::truncate(Lanes::select(Lanes::greater(x, Lanes::set(0.f)), x, Lanes::sub(x, Lanes::set(1.f))));
+	}
+
+	//contribution of one corner of the simplex
+	inline Lanes::F corner(Lanes::F x, Lanes::F y, Lanes::I gradientIndex)
+	{
+		Lanes::F t = Lanes::sub(Lanes::sub(Lanes::set(.5f), Lanes::mul(x, x)), Lanes::mul(y, y));
+		t = Lanes::max(t, Lanes::set(0.f));
+		t = Lanes::mul(t, t);
+
+		const Lanes::F dot = Lanes::add(
+			Lanes::mul(Lanes::gather(gradX, gradientIndex), x),
+			Lanes::mul(Lanes::gather(gradY, gradientIndex), y));
+
+		return Lanes::mul(Lanes::mul(t, t), dot);
+	}
+
+	template<bool ridged>
+	inline Lanes::F simplexLanes(Lanes::F inX, Lanes::F inY)
+	{
+		static constexpr float F2 = static_cast<float>(.5 * (gcem::sqrt(3.0) - 1.0));
+		static constexpr float G2 = (3.f - gcem::sqrt(3.f)) / 6.f;
+
+		const Lanes::F s = Lanes::mul(Lanes::add(inX, inY), Lanes::set(F2));
+		const Lanes::I i = fastfloor(Lanes::add(inX, s));
+		const Lanes::I j = fastfloor(Lanes::add(inY, s));
+
+		const Lanes::F t = Lanes::mul(Lanes::toFloat(Lanes::add(i, j)), Lanes::set(G2));
+		const Lanes::F x0 = Lanes::sub(inX, Lanes::sub(Lanes::toFloat(i), t));
+		const Lanes::F y0 = Lanes::sub(inY, Lanes::sub(Lanes::toFloat(j), t));
+
+		//(i1, j1) is (1, 0) in the lower triangle and (0, 1) in the upper one
+		const Lanes::I i1 = Lanes::maskToOne(Lanes::greater(x0, y0));
+		const Lanes::I j1 = Lanes::sub(Lanes::set(1), i1);
+
+		const Lanes::F x1 = Lanes::add(Lanes::sub(x0, Lanes::toFloat(i1)), Lanes::set(G2));
+		const Lanes::F y1 = Lanes::add(Lanes::sub(y0, Lanes::toFloat(j1)), Lanes::set(G2));
+		const Lanes::F x2 = Lanes::add(Lanes::sub(x0, Lanes::set(1.f)), Lanes::set(2.f * G2));
+		const Lanes::F y2 = Lanes::add(Lanes::sub(y0, Lanes::set(1.f)), Lanes::set(2.f * G2));
+
+		const Lanes::I ii = Lanes::bitAnd(i, Lanes::set(255));
+		const Lanes::I jj = Lanes::bitAnd(j, Lanes::set(255));
+		const Lanes::I one = Lanes::set(1);
+		const Lanes::I gi0 = Lanes::gather(permMod12.data(), Lanes::add(ii, Lanes::gather(perm.data(), jj)));
+		const Lanes::I gi1 = Lanes::gather(permMod12.data(), Lanes::add(Lanes::add(ii, i1), Lanes::gather(perm.data(), Lanes::add(jj, j1))));
+		const Lanes::I gi2 = Lanes::gather(permMod12.data(), Lanes::add(Lanes::add(ii, one), Lanes::gather(perm.data(), Lanes::add(jj, one))));
+
+		const Lanes::F n = Lanes::mul(Lanes::set(70.f), Lanes::add(Lanes::add(corner(x0, y0, gi0), corner(x1, y1, gi1)), corner(x2, y2, gi2)));
+
+		if constexpr (ridged)
+			return Lanes::mul(Lanes::set(2.f), Lanes::abs(Lanes::sub(Lanes::set(.5f), n)));
+		else
+			return n;
+	}
+#endif
+
+	template<bool ridged>
+	void simplexBatch(const ns::LengthType* xs, const ns::LengthType* ys, size_t count, ns::HeightType* output)
+	{
+		size_t i = 0;
+
+#ifdef NS_SIMD_LANES
+		for (; i + Lanes::width <= count; i += Lanes::width)
+		{
+			Lanes::store(output + i, simplexLanes<ridged>(Lanes::load(xs + i), Lanes::load(ys + i)));
+		}
+#endif
+
+		//remaining values that do not fill a whole register
+		for (; i < count; i++)
+		{
+			if constexpr (ridged)
+				output[i] = ns::Plane::ridgedSimplexNoise(ns::MapLengthType(xs[i], ys[i]));
+			else
+				output[i] = ns::Plane::simplexNoise(ns::MapLengthType(xs[i], ys[i]));
+		}
+	}
+}
+
+void ns::Plane::simplexNoise(const LengthType* xs, const LengthType* ys, size_t count, HeightType* output)
+{
+	simplexBatch<false>(xs, ys, count, output);
+}
+
+void ns::Plane::ridgedSimplexNoise(const LengthType* xs, const LengthType* ys, size_t count, HeightType* output)
+{
+	simplexBatch<true>(xs, ys, count, output);
+}
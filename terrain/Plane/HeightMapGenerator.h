@@ -1,7 +1,10 @@
 #pragma once
 #include <configNoisy.hpp>
+#include <Utils/BiArray.h>
+#include <Utils/ShardedCounter.h>
 #include <array>
 #include <vector>
+#include <memory>
 
 namespace ns::Plane {
 	class HeightMapGenerator
@@ -19,24 +22,66 @@ namespace ns::Plane {
 			double exponent;
 		};
 
+		//interface of the generators that are not described by a Settings object at runtime (see StaticHeightMapGenerator.h)
+		struct Evaluator {
+			virtual ~Evaluator() = default;
+			virtual Settings settings() const = 0;
+			virtual HeightType operator()(const MapLengthType& pos) const = 0;
+			virtual void operator()(const MapLengthType& start, const MapLengthType& step, size_t count, HeightType* output) const = 0;
+		};
+
 		HeightMapGenerator(const Settings& settings);
+		//wrap another generator, all the heights are then computed by the evaluator
+		HeightMapGenerator(const std::shared_ptr<const Evaluator>& evaluator);
 		const Settings& settings() const;
 		HeightType operator()(const MapLengthType& pos) const;
+		//compute count heights starting at start and moving by step between each sample, output must be able to store count heights
+		void operator()(const MapLengthType& start, const MapLengthType& step, size_t count, HeightType* output) const;
+		//compute all the heights of a grid, the sample (i, j) is at origin + step * (i, j)
+		void operator()(const MapLengthType& origin, const MapLengthType& step, BiArray<HeightType>& output) const;
+
+		//maximum difference between the batched functions and the scalar function (fused multiply-add contraction can change the last bits),
+		//the debug builds check the first and the last sample of each batch, the ones of the evaluators too
+		static constexpr HeightType batchTolerance = 1e-4_ht;
 
-#		ifndef NDEBUG
+#		if NS_TERRAIN_STATISTICS
+		struct Statistics {
+			uint64_t samples;		//number of heights computed
+			uint64_t octaves;		//number of noise values computed
+			double seconds;			//time spent in the batched functions
+		};
+		/**
+		 * @brief sum the counters of all the threads that used this generator or one of its copies
+		 * \return 
+		 */
+		Statistics statistics() const;
+		void resetStatistics();
 		size_t callCounter() const;
-#		endif // !NDEBUG
+#		endif // NS_TERRAIN_STATISTICS
 
 	protected:
 		const Settings settings_;
 		HeightType inversedAmplitudeRect_;
+		std::shared_ptr<const Evaluator> evaluator_;
+
+#		if NS_TERRAIN_STATISTICS
+		enum Counter { samplesCounter, octavesCounter, nanosecondsCounter, numberOfCounters };
+		//shared by the copies of the generator so the heightmap storage copy is counted too
+		std::shared_ptr<ShardedCounter<numberOfCounters>> counters_;
+#		endif // NS_TERRAIN_STATISTICS
 
-#		ifndef NDEBUG
-		mutable size_t numberOfComputation_;  
-#		endif // !NDEBUG
+	protected:
+		//scalar function without the statistics, so the debug check of the batches isn't counted
+		HeightType computeSample(const MapLengthType& pos) const;
+		//scalar function described by the settings, even when an evaluator computes the heights
+		HeightType computeSettingsSample(const MapLengthType& pos) const;
+		void computeBatch(const MapLengthType& start, const MapLengthType& step, size_t count, HeightType* output) const;
 	};
 
 	HeightType simplexNoise(const MapLengthType& location);
 	HeightType ridgedSimplexNoise(const MapLengthType& location);
+	//batched versions of the noises, compute count values using SIMD lanes when they are available
+	void simplexNoise(const LengthType* xs, const LengthType* ys, size_t count, HeightType* output);
+	void ridgedSimplexNoise(const LengthType* xs, const LengthType* ys, size_t count, HeightType* output);
 	int fastfloor(LengthType value);
 }
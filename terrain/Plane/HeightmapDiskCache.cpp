@@ -0,0 +1,228 @@
+#include "HeightmapDiskCache.h"
+
+//miniz
+#include <Rendering/OpenFBX/miniz.h>
+
+//stl
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <thread>
+#include <functional>
+#include <algorithm>
+
+namespace {
+	//FNV-1a
+	void hashBytes(uint64_t& hash, const void* data, size_t size)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++)
+		{
+			hash ^= bytes[i];
+			hash *= 1099511628211ULL;
+		}
+	}
+
+	template<typename T>
+	void hashValue(uint64_t& hash, const T& value)
+	{
+		hashBytes(hash, &value, sizeof(T));
+	}
+
+	//put the first byte of all the floats, then the second byte of all the floats... deflate works a lot better on that
+	void shuffle(const std::vector<unsigned char>& input, std::vector<unsigned char>& output)
+	{
+		const size_t count = input.size() / sizeof(float);
+		output.resize(input.size());
+		for (size_t i = 0; i < count; i++)
+			for (size_t b = 0; b < sizeof(float); b++)
+				output[b * count + i] = input[i * sizeof(float) + b];
+	}
+
+	void unshuffle(const std::vector<unsigned char>& input, std::vector<unsigned char>& output)
+	{
+		const size_t count = input.size() / sizeof(float);
+		output.resize(input.size());
+		for (size_t i = 0; i < count; i++)
+			for (size_t b = 0; b < sizeof(float); b++)
+				output[i * sizeof(float) + b] = input[b * count + i];
+	}
+}
+
+ns::Plane::HeightmapDiskCache::HeightmapDiskCache(const std::string& directory, const HeightMapGenerator::Settings& generator,
+	const MapLengthType& chunkPhysicalSize, const ChunkPartitionType& numberOfPartitions, bool compress)
+	:
+	settingsHash_(hash(generator, chunkPhysicalSize, numberOfPartitions)),
+	folder_(directory + "/" + std::to_string(settingsHash_) + "/"),
+	size_(numberOfPartitions.x + 1, numberOfPartitions.y + 1),
+	compress_(compress)
+{
+	std::error_code error;
+	std::filesystem::create_directories(folder_, error);
+
+	//the write time of a folder tells when its configuration was used for the last time
+	std::filesystem::last_write_time(folder_, std::filesystem::file_time_type::clock::now(), error);
+	prune(directory);
+}
+
+bool ns::Plane::HeightmapDiskCache::load(const GridPositionType& chunk, Tile& tile) const
+{
+	std::ifstream file(tilePath(chunk), std::ios::binary);
+	if (!file.is_open()) return false;
+
+	Header header;
+	if (!file.read(reinterpret_cast<char*>(&header), sizeof(Header))) return false;
+
+	//check that the tile was made for this cache
+	if (std::memcmp(header.magic, "NSHM", 4) != 0 or header.version != version or header.settingsHash != settingsHash_ or
+		header.chunkX != chunk.x or header.chunkY != chunk.y or header.width != size_.x or header.height != size_.y or
+		header.rawSize != numberOfHeights() * sizeof(HeightType))
+		return false;
+
+	//the size of the payload comes from the file so it is checked before the allocation (and a raw payload must hold all the heights)
+	if (header.compressed ? header.payloadSize > mz_compressBound(header.rawSize) : header.payloadSize != header.rawSize)
+		return false;
+
+	std::vector<unsigned char> payload(header.payloadSize);
+	if (!file.read(reinterpret_cast<char*>(payload.data()), payload.size())) return false;
+
+	std::vector<unsigned char> raw;
+	if (header.compressed) {
+		std::vector<unsigned char> shuffled(header.rawSize);
+		mz_ulong size = header.rawSize;
+		if (mz_uncompress(shuffled.data(), &size, payload.data(), static_cast<mz_ulong>(payload.size())) != MZ_OK or size != header.rawSize)
+			return false;
+		unshuffle(shuffled, raw);
+	}
+	else {
+		raw = std::move(payload);
+	}
+
+	//values then bottom, top, left and right lines
+	const HeightType* heights = reinterpret_cast<const HeightType*>(raw.data());
+	tile.values.assign(heights, heights + (size_t)size_.x * size_.y);
+	heights += (size_t)size_.x * size_.y;
+
+	for (unsigned edge = 0; edge < 4; edge++)
+	{
+		const size_t length = (edge < 2) ? size_.x : size_.y;
+		tile.neighbors[edge].assign(heights, heights + length);
+		heights += length;
+	}
+
+	return true;
+}
+
+void ns::Plane::HeightmapDiskCache::save(const GridPositionType& chunk, const Tile& tile) const
+{
+	std::vector<unsigned char> raw(numberOfHeights() * sizeof(HeightType));
+	unsigned char* cursor = raw.data();
+
+	std::memcpy(cursor, tile.values.data(), tile.values.size() * sizeof(HeightType));
+	cursor += tile.values.size() * sizeof(HeightType);
+	for (const auto& line : tile.neighbors)
+	{
+		std::memcpy(cursor, line.data(), line.size() * sizeof(HeightType));
+		cursor += line.size() * sizeof(HeightType);
+	}
+
+	Header header{};
+	std::memcpy(header.magic, "NSHM", 4);
+	header.version = version;
+	header.settingsHash = settingsHash_;
+	header.chunkX = chunk.x;
+	header.chunkY = chunk.y;
+	header.width = size_.x;
+	header.height = size_.y;
+	header.rawSize = static_cast<uint32_t>(raw.size());
+
+	std::vector<unsigned char> payload;
+	if (compress_) {
+		std::vector<unsigned char> shuffled;
+		shuffle(raw, shuffled);
+
+		mz_ulong size = mz_compressBound(static_cast<mz_ulong>(shuffled.size()));
+		payload.resize(size);
+		if (mz_compress2(payload.data(), &size, shuffled.data(), static_cast<mz_ulong>(shuffled.size()), MZ_BEST_SPEED) != MZ_OK)
+			return;
+		payload.resize(size);
+		header.compressed = 1;
+	}
+	else {
+		payload = std::move(raw);
+		header.compressed = 0;
+	}
+	header.payloadSize = static_cast<uint32_t>(payload.size());
+
+	//write in a temporary file and then rename it so a reader never see a partial tile
+	const std::string path = tilePath(chunk);
+	const std::string temporaryPath = path + ".tmp" + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id()));
+	{
+		std::ofstream file(temporaryPath, std::ios::binary | std::ios::trunc);
+		if (!file.is_open()) return;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+		file.write(reinterpret_cast<const char*>(payload.data()), payload.size());
+		if (!file) return;
+	}
+
+	std::error_code error;
+	std::filesystem::rename(temporaryPath, path, error);
+	if (error)
+		std::filesystem::remove(temporaryPath, error);
+}
+
+uint64_t ns::Plane::HeightmapDiskCache::hash(const HeightMapGenerator::Settings& generator, const MapLengthType& chunkPhysicalSize, const ChunkPartitionType& numberOfPartitions)
+{
+	uint64_t ret = 14695981039346656037ULL;
+
+	hashValue(ret, version);
+	for (const auto& octave : generator.octaves)
+	{
+		hashValue(ret, octave.frequency);
+		hashValue(ret, octave.amplitude);
+		hashValue(ret, octave.offset);
+		hashValue(ret, octave.ridged);
+	}
+	hashValue(ret, generator.exponent);
+	hashValue(ret, chunkPhysicalSize.x);
+	hashValue(ret, chunkPhysicalSize.y);
+	hashValue(ret, static_cast<uint64_t>(numberOfPartitions.x));
+	hashValue(ret, static_cast<uint64_t>(numberOfPartitions.y));
+
+	return ret;
+}
+
+std::string ns::Plane::HeightmapDiskCache::tilePath(const GridPositionType& chunk) const
+{
+	return folder_ + std::to_string(chunk.x) + "_" + std::to_string(chunk.y) + ".nsh";
+}
+
+void ns::Plane::HeightmapDiskCache::prune(const std::string& directory) const
+{
+	namespace fs = std::filesystem;
+	std::error_code error;
+
+	//only the folders named with a hash belong to the caches
+	std::vector<std::pair<fs::file_time_type, fs::path>> folders;
+	for (const auto& entry : fs::directory_iterator(directory, error))
+	{
+		const std::string name = entry.path().filename().string();
+		if (!entry.is_directory(error) or name.empty() or name == std::to_string(settingsHash_) or
+			!std::all_of(name.begin(), name.end(), [](char c) { return c >= '0' and c <= '9'; }))
+			continue;
+
+		folders.emplace_back(entry.last_write_time(error), entry.path());
+	}
+
+	if (folders.size() < keptConfigurations) return;
+
+	//this configuration is one of the kept ones, the most recent of the others fill the remaining places
+	std::sort(folders.begin(), folders.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+	for (size_t i = keptConfigurations - 1; i < folders.size(); i++)
+		fs::remove_all(folders[i].second, error);
+}
+
+size_t ns::Plane::HeightmapDiskCache::numberOfHeights() const
+{
+	return (size_t)size_.x * size_.y + 2 * (size_t)size_.x + 2 * (size_t)size_.y;
+}
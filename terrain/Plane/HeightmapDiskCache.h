@@ -0,0 +1,87 @@
+#pragma once
+
+//noisy
+#include <configNoisy.hpp>
+#include <terrain/Plane/HeightMapGenerator.h>
+
+//stl
+#include <string>
+#include <vector>
+#include <array>
+#include <cstdint>
+
+namespace ns::Plane {
+	/**
+	 * @brief store the heights of the chunks on the disk so they don't need to be generated again the next time.
+	 * Each tile is a file in a folder named with a hash of the generation settings, so changing the settings never
+	 * read old tiles. A tile is a fixed size header followed by the heights of the chunk and the heights of its four
+	 * neighbor lines. When the tile is not compressed the heights are stored as raw floats right after the header
+	 * so the file can be memory mapped, else the bytes of the floats are shuffled into planes and deflated with miniz.
+	 * Opening a cache removes the folders of the oldest configurations, so tuning the settings doesn't fill the disk.
+	 */
+	class HeightmapDiskCache
+	{
+	public:
+		//heights of a chunk as they are stored in a tile
+		struct Tile {
+			std::vector<HeightType> values;						//(numberOfPartitions + 1) heights in row major order
+			std::array<std::vector<HeightType>, 4> neighbors;	//neighbor lines heights (same order as HeightmapStorage::Result)
+		};
+
+		struct Header {
+			char magic[4];				//"NSHM"
+			uint32_t version;
+			uint64_t settingsHash;
+			int32_t chunkX;
+			int32_t chunkY;
+			uint32_t width;				//number of heights in a row
+			uint32_t height;			//number of rows
+			uint32_t compressed;		//1 if the payload is deflated
+			uint32_t payloadSize;		//size of the payload in the file
+			uint32_t rawSize;			//size of the payload once inflated
+			uint32_t padding;			//keep the payload aligned on 8 bytes
+		};
+
+		static constexpr uint32_t version = 1;
+		//number of configurations whose tiles stay in the directory (the most recently opened ones)
+		static constexpr size_t keptConfigurations = 4;
+
+		/**
+		 * @brief create the cache of one generation configuration
+		 * \param directory folder where all the caches are stored
+		 * \param generator generation settings
+		 * \param chunkPhysicalSize
+		 * \param numberOfPartitions
+		 * \param compress deflate the tiles
+		 */
+		HeightmapDiskCache(const std::string& directory, const HeightMapGenerator::Settings& generator,
+			const MapLengthType& chunkPhysicalSize, const ChunkPartitionType& numberOfPartitions, bool compress = true);
+		/**
+		 * @brief read a tile
+		 * \param chunk chunk grid position
+		 * \param tile output
+		 * \return false if the tile doesn't exist or is invalid
+		 */
+		bool load(const GridPositionType& chunk, Tile& tile) const;
+		/**
+		 * @brief write a tile (errors are ignored, the tile will just be generated again)
+		 * \param chunk chunk grid position
+		 * \param tile heights to store
+		 */
+		void save(const GridPositionType& chunk, const Tile& tile) const;
+
+		static uint64_t hash(const HeightMapGenerator::Settings& generator, const MapLengthType& chunkPhysicalSize, const ChunkPartitionType& numberOfPartitions);
+
+	protected:
+		const uint64_t settingsHash_;
+		const std::string folder_;
+		const glm::uvec2 size_;
+		const bool compress_;
+
+	protected:
+		std::string tilePath(const GridPositionType& chunk) const;
+		//remove the folders of the other configurations except the most recently opened ones
+		void prune(const std::string& directory) const;
+		size_t numberOfHeights() const;
+	};
+}
@@ -1,5 +1,10 @@
 #include "HeightmapStorage.h"
 
+//stl
+#include <cmath>
+#include <algorithm>
+#include <cstdint>
+
 #define WIDTH (settings_.numberOfPartitions.x + (size_t)1U)
 #define HEIGHT (settings_.numberOfPartitions.y + (size_t)1U) 
 
@@ -12,7 +17,11 @@ ns::Plane::HeightmapStorage::HeightmapStorage(const ns::Plane::HeightmapStorage:
 	data_({ 
 		(MapLengthType)settings_.chunkPhysicalSize / (MapLengthType)settings_.numberOfPartitions
 		})
-{}
+{
+	if (!settings_.diskCacheDirectory.empty())
+		diskCache_ = std::make_unique<HeightmapDiskCache>(settings_.diskCacheDirectory, settings_.generator.settings(),
+			settings_.chunkPhysicalSize, settings_.numberOfPartitions);
+}
 
 std::shared_ptr<ns::Plane::HeightmapStorage::Result> ns::Plane::HeightmapStorage::operator()(const Input& input)
 {
@@ -22,80 +31,217 @@ std::shared_ptr<ns::Plane::HeightmapStorage::Result> ns::Plane::HeightmapStorage
 	std::shared_ptr<ns::Plane::HeightmapStorage::Result> result = std::make_shared<Result>((glm::ivec2)settings_.numberOfPartitions + glm::ivec2(1));
 	result->chunk = input;
 
-	for (size_t i = 0; i < result->values.x(); i++)
+	//take the borders that the neighbor chunks already computed
+	std::array<BorderCache::Border, 4> borders;
+	std::array<bool, 4> known;
+	for (unsigned edge = 0; edge < 4; edge++)
 	{
-		for (size_t j = 0; j < result->values.y(); j++)
-		{
-			result->values.value(i, j) = settings_.generator(MapLengthType(
-				settings_.chunkPhysicalSize.x * input.x + i * data_.primitiveSize.x,
-				settings_.chunkPhysicalSize.y * input.y + j * data_.primitiveSize.y
-			));
+		known[edge] = borders_.take(input + BorderCache::neighborOffset(edge), BorderCache::opposite(edge), borders[edge]);
+	}
+
+	//read the chunk from the disk if it was generated during a previous run
+	if (diskCache_) {
+		thread_local HeightmapDiskCache::Tile tile;
+		if (diskCache_->load(input, tile) and fillFromTile(*result, tile)) {
+			storeBorders(*result, known);
+
+			if (settings_.quantizationStep > 0)
+				result->quantize(settings_.quantizationStep);
+
+			return result;
 		}
 	}
 
-	//calculate proximity vertices heights
-	
-	NeighborChunkLine left;
-	left.chunkPos = input + GridPositionType(-1, 0);
-	left.neighborChunk = input;
-	left.positions.resize(HEIGHT);
-	for (size_t i = 0; i < HEIGHT; i++)
+	fillKnownBorders(*result, borders, known);
+
+	//compute the rest of the grid row by row
+	const size_t firstColumn = known[Result::left] ? 1 : 0;
+	const size_t lastColumn = known[Result::right] ? WIDTH - 2 : WIDTH - 1;
+	for (size_t j = 0; j < HEIGHT; j++)
 	{
-		left.positions[i].y = settings_.generator(MapLengthType(
-			settings_.chunkPhysicalSize.x * input.x - data_.primitiveSize.x,
-			settings_.chunkPhysicalSize.y * input.y + i * data_.primitiveSize.y
-		));
+		if (j == 0 and known[Result::bottom]) continue;
+		if (j == HEIGHT - 1 and known[Result::top]) continue;
+
+		settings_.generator(
+			MapLengthType(chunkPosition.x + firstColumn * data_.primitiveSize.x, chunkPosition.y + j * data_.primitiveSize.y),
+			MapLengthType(data_.primitiveSize.x, 0),
+			lastColumn - firstColumn + 1,
+			&result->values->value(firstColumn, j));
 	}
+
+	//calculate proximity vertices heights, the inner lines of the neighbors borders are exactly those vertices
 	
-	NeighborChunkLine right;
-	right.chunkPos = input + GridPositionType(1, 0);
-	right.neighborChunk = input;
-	right.positions.resize(HEIGHT);
-	for (size_t i = 0; i < HEIGHT; i++)
-	{
-		right.positions[i].y = settings_.generator(MapLengthType(
-			settings_.chunkPhysicalSize.x * input.x + (WIDTH) *  data_.primitiveSize.x,
-			settings_.chunkPhysicalSize.y * input.y + i * data_.primitiveSize.y
-		));
+	auto& left = result->neighbors[Result::left];
+	left = partiallyComputedChunks_.acquire(input + GridPositionType(-1, 0), input);
+	if (known[Result::left])
+		fillLine(*left, borders[Result::left].inner);
+	else
+		fillLine(*left, MapLengthType(chunkPosition.x - data_.primitiveSize.x, chunkPosition.y), MapLengthType(0, data_.primitiveSize.y), HEIGHT);
+	
+	auto& right = result->neighbors[Result::right];
+	right = partiallyComputedChunks_.acquire(input + GridPositionType(1, 0), input);
+	if (known[Result::right])
+		fillLine(*right, borders[Result::right].inner);
+	else
+		fillLine(*right, MapLengthType(chunkPosition.x + (WIDTH) * data_.primitiveSize.x, chunkPosition.y), MapLengthType(0, data_.primitiveSize.y), HEIGHT);
+
+	auto& bottom = result->neighbors[Result::bottom];
+	bottom = partiallyComputedChunks_.acquire(input + GridPositionType(0, -1), input);
+	if (known[Result::bottom])
+		fillLine(*bottom, borders[Result::bottom].inner);
+	else
+		fillLine(*bottom, MapLengthType(chunkPosition.x, chunkPosition.y - data_.primitiveSize.y), MapLengthType(data_.primitiveSize.x, 0), WIDTH);
+
+	auto& top = result->neighbors[Result::top];
+	top = partiallyComputedChunks_.acquire(input + GridPositionType(0, 1), input);
+	if (known[Result::top])
+		fillLine(*top, borders[Result::top].inner);
+	else
+		fillLine(*top, MapLengthType(chunkPosition.x, chunkPosition.y + (HEIGHT) * data_.primitiveSize.y), MapLengthType(data_.primitiveSize.x, 0), WIDTH);
+
+	//share the borders with the neighbors that are not generated yet
+	storeBorders(*result, known);
+
+	if (diskCache_)
+		saveTile(*result);
+
+	//the float heights are not needed anymore, the borders and the tile were made with them so the neighbors stay exact
+	if (settings_.quantizationStep > 0)
+		result->quantize(settings_.quantizationStep);
+
+	return result;
+}
+
+void ns::Plane::HeightmapStorage::evict(const GridPositionType& centralChunk, unsigned distance)
+{
+	borders_.evict(centralChunk, distance);
+}
+
+void ns::Plane::HeightmapStorage::fillLine(NeighborChunkLine& line, const MapLengthType& start, const MapLengthType& step, size_t count) const
+{
+	line.heights.resize(count);
+	settings_.generator(start, step, count, line.heights.data());
+}
+
+void ns::Plane::HeightmapStorage::fillLine(NeighborChunkLine& line, const std::vector<HeightType>& heights) const
+{
+	line.heights.assign(heights.begin(), heights.end());
+}
+
+void ns::Plane::HeightmapStorage::fillKnownBorders(Result& result, const std::array<BorderCache::Border, 4>& borders, const std::array<bool, 4>& known) const
+{
+	if (known[Result::left])
+		for (size_t j = 0; j < HEIGHT; j++)
+			result.values->value(0, j) = borders[Result::left].edge[j];
+
+	if (known[Result::right])
+		for (size_t j = 0; j < HEIGHT; j++)
+			result.values->value(WIDTH - 1, j) = borders[Result::right].edge[j];
+
+	if (known[Result::bottom])
+		for (size_t i = 0; i < WIDTH; i++)
+			result.values->value(i, 0) = borders[Result::bottom].edge[i];
+
+	if (known[Result::top])
+		for (size_t i = 0; i < WIDTH; i++)
+			result.values->value(i, HEIGHT - 1) = borders[Result::top].edge[i];
+}
+
+void ns::Plane::HeightmapStorage::storeBorders(const Result& result, const std::array<bool, 4>& known)
+{
+	//the neighbor of a known border is already generated so it doesn't need this chunk border
+	if (!known[Result::left]) {
+		BorderCache::Border border;
+		for (size_t j = 0; j < HEIGHT; j++) {
+			border.edge.push_back(result.values->value(0, j));
+			border.inner.push_back(result.values->value(1, j));
+		}
+		borders_.store(result.chunk, Result::left, std::move(border));
 	}
 
-	NeighborChunkLine bottom;
-	bottom.chunkPos = input + GridPositionType(0, -1);
-	bottom.neighborChunk = input;
-	bottom.positions.resize(WIDTH);
-	for (size_t i = 0; i < WIDTH; i++)
+	if (!known[Result::right]) {
+		BorderCache::Border border;
+		for (size_t j = 0; j < HEIGHT; j++) {
+			border.edge.push_back(result.values->value(WIDTH - 1, j));
+			border.inner.push_back(result.values->value(WIDTH - 2, j));
+		}
+		borders_.store(result.chunk, Result::right, std::move(border));
+	}
+
+	if (!known[Result::bottom]) {
+		BorderCache::Border border;
+		border.edge.assign(&result.values->value(0, 0), &result.values->value(0, 0) + WIDTH);
+		border.inner.assign(&result.values->value(0, 1), &result.values->value(0, 1) + WIDTH);
+		borders_.store(result.chunk, Result::bottom, std::move(border));
+	}
+
+	if (!known[Result::top]) {
+		BorderCache::Border border;
+		border.edge.assign(&result.values->value(0, HEIGHT - 1), &result.values->value(0, HEIGHT - 1) + WIDTH);
+		border.inner.assign(&result.values->value(0, HEIGHT - 2), &result.values->value(0, HEIGHT - 2) + WIDTH);
+		borders_.store(result.chunk, Result::top, std::move(border));
+	}
+}
+
+bool ns::Plane::HeightmapStorage::fillFromTile(Result& result, const HeightmapDiskCache::Tile& tile)
+{
+	if (tile.values.size() != WIDTH * HEIGHT) return false;
+
+	std::copy(tile.values.begin(), tile.values.end(), result.values->data());
+
+	for (unsigned edge = 0; edge < 4; edge++)
 	{
-		bottom.positions[i].y = settings_.generator(MapLengthType(
-			settings_.chunkPhysicalSize.x * input.x + i * data_.primitiveSize.x,
-			settings_.chunkPhysicalSize.y * input.y - data_.primitiveSize.y
-		));
+		auto& line = result.neighbors[edge];
+		line = partiallyComputedChunks_.acquire(result.chunk + BorderCache::neighborOffset(edge), result.chunk);
+		fillLine(*line, tile.neighbors[edge]);
 	}
 
-	NeighborChunkLine top;
-	top.chunkPos = input + GridPositionType(0, 1);
-	top.neighborChunk = input;
-	top.positions.resize(WIDTH);
-	for (size_t i = 0; i < WIDTH; i++)
+	return true;
+}
+
+void ns::Plane::HeightmapStorage::saveTile(const Result& result) const
+{
+	thread_local HeightmapDiskCache::Tile tile;
+
+	tile.values.assign(&result.values->value(0, 0), &result.values->value(0, 0) + WIDTH * HEIGHT);
+
+	for (unsigned edge = 0; edge < 4; edge++)
 	{
-		top.positions[i].y = settings_.generator(MapLengthType(
-			settings_.chunkPhysicalSize.x * input.x + i * data_.primitiveSize.x,
-			settings_.chunkPhysicalSize.y * input.y + (HEIGHT) * data_.primitiveSize.y
-		));
+		tile.neighbors[edge] = result.neighbors[edge]->heights;
 	}
 
-	partiallyComputedChunks_.reserve(partiallyComputedChunks_.size() + 4);
+	diskCache_->save(result.chunk, tile);
+}
 
-	partiallyComputedChunks_.emplace_back(right);
-	result->neighbors[Result::right] = &partiallyComputedChunks_.back();
+void ns::Plane::HeightmapStorage::Result::quantize(HeightType step)
+{
+	if (!values) return;
 
-	partiallyComputedChunks_.emplace_back(left); 
-	result->neighbors[Result::left] = &partiallyComputedChunks_.back();
+	//heights as a number of steps
+	int64_t minimum = INT64_MAX;
+	int64_t maximum = INT64_MIN;
+	for (size_t i = 0; i < values->size(); i++)
+	{
+		const int64_t steps = std::llround((*values)[i] / step);
+		minimum = std::min(minimum, steps);
+		maximum = std::max(maximum, steps);
+	}
 
-	partiallyComputedChunks_.emplace_back(top); 
-	result->neighbors[Result::top] = &partiallyComputedChunks_.back();
+	//the heights that don't fit in 16 bits keep their float precision, so all the quantized chunks use the same lattice
+	if (maximum - minimum > UINT16_MAX) return;
 
-	partiallyComputedChunks_.emplace_back(bottom); 
-	result->neighbors[Result::bottom] = &partiallyComputedChunks_.back();
+	quantized.minimum = minimum;
+	quantized.scale = step;
+	quantized.values.resize(values->size());
+	for (size_t i = 0; i < values->size(); i++)
+		quantized.values[i] = (uint16_t)(std::llround((*values)[i] / step) - minimum);
 
-	return result;
+	values.reset();
 }
+
+size_t ns::Plane::HeightmapStorage::Result::heightsMemory() const
+{
+	if (values)
+		return values->size() * sizeof(HeightType);
+	return quantized.values.size() * sizeof(uint16_t);
+}
\ No newline at end of file
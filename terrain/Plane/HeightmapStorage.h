@@ -5,11 +5,15 @@
 #include <Rendering/Mesh.h>
 #include <Utils/BiArray.h>
 #include <terrain/Plane/HeightMapGenerator.h>
+#include <terrain/Plane/BorderCache.h>
+#include <terrain/Plane/NeighborLineStore.h>
+#include <terrain/Plane/HeightmapDiskCache.h>
 
 //stl
 #include <vector>
 #include <array>
 #include <memory>
+#include <string>
 
 //glm
 #include <glm/glm.hpp>
@@ -19,23 +23,23 @@ namespace ns::Plane {
 	{
 	public:
 		struct Settings {
-			Settings(const HeightMapGenerator& gen, MapLengthType size = {16, 16}, ChunkPartitionType parts = ns::defaultSize)
+			Settings(const HeightMapGenerator& gen, MapLengthType size = {16, 16}, ChunkPartitionType parts = ns::defaultSize, const std::string& cacheDirectory = "",
+				HeightType quantization = 0)
 				:
 				chunkPhysicalSize(size),
 				numberOfPartitions(parts),
-				generator(gen)
+				generator(gen),
+				diskCacheDirectory(cacheDirectory),
+				quantizationStep(quantization)
 			{}
 			MapLengthType chunkPhysicalSize = MapLengthType(16);
 			ChunkPartitionType numberOfPartitions = ns::defaultSize;
 			HeightMapGenerator generator;
+			std::string diskCacheDirectory;		//folder where the heights are saved between runs (empty to disable the disk cache)
+			HeightType quantizationStep = 0;	//precision of the 16 bits heights of the results (0 to keep 32 bits heights)
 		};
 
-		struct NeighborChunkLine {
-			std::vector<glm::vec<3, LengthType>> positions;		//lines of vertices, the heights are stored in y and the rest is computed by the meshGenerator 
-			GridPositionType chunkPos;			//chunk where the vertices are
-			GridPositionType neighborChunk;		//chunk that is really close to these vertices
-			bool xzComputed = false;
-		};
+		using NeighborChunkLine = ns::Plane::NeighborChunkLine;
 
 		//need a chunk pos to work
 		using Input = GridPositionType;
@@ -43,13 +47,37 @@ namespace ns::Plane {
 		//output an array of heights but also the heights really close to the the chunk
 		struct Result {
 			Result(const glm::ivec2 biarraySize) :
-				values(biarraySize),
+				values(std::make_unique<BiArray<HeightType>>(biarraySize)),
+				size(biarraySize),
 				chunk(0, 0),
 				neighbors()
 			{}
 
-			BiArray<HeightType> values;
-			std::array<NeighborChunkLine*, 4> neighbors;
+			//height of the vertex (x, y), it works with the float heights and with the quantized heights
+			HeightType height(uint32_t x, uint32_t y) const {
+				if (values) return values->value(x, y);
+				//the number of steps is computed first so a height shared by two chunks gives the same float in both
+				return (HeightType)(quantized.minimum + quantized.values[TWO_DIM((size_t)x, (size_t)y, (size_t)size.x)]) * quantized.scale;
+			}
+			/**
+			 * @brief replace the float heights by 16 bits heights and free them
+			 * the heights are rounded to a multiple of step, so two chunks round their common border to the same heights.
+			 * if the heights of the chunk are too far apart for 16 bits with this step, the float heights are kept
+			 * (a bigger step would round the border differently than the neighbors)
+			 * \param step precision of the heights
+			 */
+			void quantize(HeightType step);
+			//size of the heights in bytes (without the neighbor lines)
+			size_t heightsMemory() const;
+
+			std::unique_ptr<BiArray<HeightType>> values;		//float heights, null once the result is quantized
+			struct {
+				std::vector<uint16_t> values;
+				int64_t minimum = 0;							//in steps
+				HeightType scale = 0;
+			} quantized;										//heights as (minimum + value) * scale, empty if the result is not quantized
+			glm::ivec2 size;
+			std::array<std::shared_ptr<NeighborChunkLine>, 4> neighbors;
 			ns::GridPositionType chunk;
 
 			static constexpr unsigned int bottom = 0;	//neighbors are stored in the array using those values
@@ -62,6 +90,12 @@ namespace ns::Plane {
 		HeightmapStorage(const HeightmapStorage::Settings& settings);
 
 		std::shared_ptr<Result> operator()(const Input& input);
+		/**
+		 * @brief forget the borders of the chunks that are further than distance from the central chunk
+		 * \param centralChunk
+		 * \param distance
+		 */
+		void evict(const GridPositionType& centralChunk, unsigned distance);
 
 	protected:
 		const Settings settings_;
@@ -71,7 +105,23 @@ namespace ns::Plane {
 			MapLengthType primitiveSize;
 		} data_;
 
-		std::vector<NeighborChunkLine> partiallyComputedChunks_;
+		NeighborLineStore partiallyComputedChunks_;	//neighbor lines of the chunks, held by their results
+		BorderCache borders_;		//borders of the generated chunks that their neighbors can reuse
+		std::unique_ptr<HeightmapDiskCache> diskCache_;
+
+	protected:
+		//compute the heights of a line of count vertices that start at start and are separated by step
+		void fillLine(NeighborChunkLine& line, const MapLengthType& start, const MapLengthType& step, size_t count) const;
+		//copy already computed heights into a line
+		void fillLine(NeighborChunkLine& line, const std::vector<HeightType>& heights) const;
+		//copy the borders taken from the cache into the chunk heights
+		void fillKnownBorders(Result& result, const std::array<BorderCache::Border, 4>& borders, const std::array<bool, 4>& known) const;
+		//put the borders that the neighbors will need into the cache
+		void storeBorders(const Result& result, const std::array<bool, 4>& known);
+		//copy a tile read from the disk into the result, return false if the tile doesn't fit this storage
+		bool fillFromTile(Result& result, const HeightmapDiskCache::Tile& tile);
+		//save the heights of a generated chunk on the disk
+		void saveTile(const Result& result) const;
 
 		friend class MeshGenerator;		
 	};
@@ -1,5 +1,4 @@
 #include "MeshGenerator.h"
-#include <Utils/DebugLayer.h>
 
 #include <Utils/BiArray.h>
 
@@ -8,219 +7,289 @@ ns::Plane::MeshGenerator::MeshGenerator(const HeightmapStorage& heightGen, const
 	settings_(settings),
 	data_(heightGen.data_),
 	heightMapSettings_(heightGen.settings_)
-{}
+{
+	//the indices only depend on the level of detail so they are computed once for all the chunks
+	for (unsigned level = 0; level < numberOfLevels(); level++)
+	{
+		auto indices = std::make_shared<std::vector<unsigned>>();
+		genTopology(1U << level, *indices);
+		topologies_.push_back(indices);
+	}
+}
 
-void ns::Plane::MeshGenerator::operator()(const MeshGenerator::Input& heightmap, Result& result)
+void ns::Plane::MeshGenerator::operator()(const MeshGenerator::Input& heightmap, Result& result, unsigned levelOfDetail)
 {
-	const MapLengthType chunkWorldPosition = heightMapSettings_.chunkPhysicalSize * (MapLengthType)heightmap.chunk;
+	const unsigned stride = 1U << std::min(levelOfDetail, numberOfLevels() - 1);
+
+	if (settings_.normals == Settings::Normals::none) return;
 
 	if(settings_.normals == Settings::Normals::flat)
-		genFlatNormalsMesh(heightmap, result, chunkWorldPosition);
-	else if (settings_.normals == Settings::Normals::smooth)
-		genSmoothNormalsMesh(heightmap, result, chunkWorldPosition);
+		genFlatNormalsMesh(heightmap, result, stride);
+	else
+		genSmoothNormalsMesh(heightmap, result, stride);
+
+	addSkirts(heightmap, result, stride);
+}
+
+ns::VertexLayout ns::Plane::MeshGenerator::vertexLayout() const
+{
+	return VertexLayout::terrain(data_.primitiveSize);
+}
+
+ns::MapLengthType ns::Plane::MeshGenerator::chunkOrigin(const GridPositionType& chunk) const
+{
+	return heightMapSettings_.chunkPhysicalSize * (MapLengthType)chunk;
+}
+
+const std::shared_ptr<const std::vector<unsigned>>& ns::Plane::MeshGenerator::topology(unsigned levelOfDetail) const
+{
+	return topologies_[std::min<size_t>(levelOfDetail, topologies_.size() - 1)];
+}
+
+unsigned ns::Plane::MeshGenerator::numberOfLevels() const
+{
+	unsigned levels = 1;
+	while ((1U << levels) <= heightMapSettings_.numberOfPartitions.x and (1U << levels) <= heightMapSettings_.numberOfPartitions.y and
+		heightMapSettings_.numberOfPartitions.x % (1U << levels) == 0 and heightMapSettings_.numberOfPartitions.y % (1U << levels) == 0)
+		levels++;
+
+	return levels;
 }
 
-void ns::Plane::MeshGenerator::genFlatNormalsMesh(const MeshGenerator::Input& heightmap, Result& result, const MapLengthType& chunkPosition)
+void ns::Plane::MeshGenerator::genFlatNormalsMesh(const MeshGenerator::Input& heightmap, Result& result, unsigned stride)
 {
+	const MapLengthType origin(0);
 
 	result.indexed = false;
+	result.sharedIndices = nullptr;
 
-	result.vertices.resize(heightMapSettings_.numberOfPartitions.x * heightMapSettings_.numberOfPartitions.y * 6);
+	result.vertices.resize((size_t)(heightMapSettings_.numberOfPartitions.x / stride) * (heightMapSettings_.numberOfPartitions.y / stride) * 6);
 
 	size_t verticesIndex = 0;
-	for (size_t i = 0; i < heightMapSettings_.numberOfPartitions.x; i++) {
+	for (size_t i = 0; i < heightMapSettings_.numberOfPartitions.x; i += stride) {
 
-		for (size_t j = 0; j < heightMapSettings_.numberOfPartitions.y; j++) {
+		for (size_t j = 0; j < heightMapSettings_.numberOfPartitions.y; j += stride) {
 
-			const size_t heightMapWidth = heightMapSettings_.numberOfPartitions.x + 1;
-			const glm::vec3 a(VertexWorldPosition(chunkPosition, heightmap.values[TWO_DIM((i + 0), (j + 0), heightMapWidth)], i + 0, j + 0));
-			const glm::vec3 b(VertexWorldPosition(chunkPosition, heightmap.values[TWO_DIM((i + 1), (j + 0), heightMapWidth)], i + 1, j + 0));
-			const glm::vec3 c(VertexWorldPosition(chunkPosition, heightmap.values[TWO_DIM((i + 0), (j + 1), heightMapWidth)], i + 0, j + 1));
-			const glm::vec3 d(VertexWorldPosition(chunkPosition, heightmap.values[TWO_DIM((i + 1), (j + 1), heightMapWidth)], i + 1, j + 1));
+			const glm::vec3 a(VertexWorldPosition(origin, heightmap.height(i + 0, j + 0), i + 0, j + 0));
+			const glm::vec3 b(VertexWorldPosition(origin, heightmap.height(i + stride, j + 0), i + stride, j + 0));
+			const glm::vec3 c(VertexWorldPosition(origin, heightmap.height(i + 0, j + stride), i + 0, j + stride));
+			const glm::vec3 d(VertexWorldPosition(origin, heightmap.height(i + stride, j + stride), i + stride, j + stride));
 			
 			Triangle triangle(a, b, c);
 			triangle.genNormal();
 
-			result.vertices.emplace(result.vertices.begin() + verticesIndex + 0, a, triangle.normal);
-			result.vertices.emplace(result.vertices.begin() + verticesIndex + 1, b, triangle.normal);
-			result.vertices.emplace(result.vertices.begin() + verticesIndex + 2, c, triangle.normal);
+			result.vertices[verticesIndex + 0] = TerrainVertex(i + 0, j + 0, a.y, triangle.normal);
+			result.vertices[verticesIndex + 1] = TerrainVertex(i + stride, j + 0, b.y, triangle.normal);
+			result.vertices[verticesIndex + 2] = TerrainVertex(i + 0, j + stride, c.y, triangle.normal);
 
 			triangle = Triangle(c, b, d);
 			triangle.genNormal();
 
-			result.vertices.emplace(result.vertices.begin() + verticesIndex + 3, c, triangle.normal);
-			result.vertices.emplace(result.vertices.begin() + verticesIndex + 4, b, triangle.normal);
-			result.vertices.emplace(result.vertices.begin() + verticesIndex + 5, d, triangle.normal);
+			result.vertices[verticesIndex + 3] = TerrainVertex(i + 0, j + stride, c.y, triangle.normal);
+			result.vertices[verticesIndex + 4] = TerrainVertex(i + stride, j + 0, b.y, triangle.normal);
+			result.vertices[verticesIndex + 5] = TerrainVertex(i + stride, j + stride, d.y, triangle.normal);
 
 			verticesIndex += 6;
 		}
 	}
 }
 
-void ns::Plane::MeshGenerator::genSmoothNormalsMesh(const MeshGenerator::Input& heightmap, Result& result, const MapLengthType& chunkPosition)
+void ns::Plane::MeshGenerator::genSmoothNormalsMesh(const MeshGenerator::Input& heightmap, Result& result, unsigned stride)
 {
-	result.primitiveType = GL_LINES;
 	result.primitiveType = GL_TRIANGLES;
 	result.indexed = true;
-	
+
 	const glm::ivec2 size(heightMapSettings_.numberOfPartitions.x + 1, heightMapSettings_.numberOfPartitions.y + 1);
+	const glm::ivec2 coarseSize(heightMapSettings_.numberOfPartitions.x / stride + 1, heightMapSettings_.numberOfPartitions.y / stride + 1);
 
-	BiArray<glm::vec3> positions(size + glm::ivec2(2), glm::vec3(1));
-	BiArray<MeshGenerator::Quad> quads(size + glm::ivec2(1), MeshGenerator::Quad(1, 2, 3, 4));
+	//heights of the chunk surrounded by the neighbor lines, the buffer of each thread is reused by all its chunks
+	thread_local std::vector<HeightType> padded;
+	const size_t paddedWidth = (size_t)size.x + 2;
+	padded.resize(paddedWidth * ((size_t)size.y + 2));
+	fillPaddedHeights(heightmap, padded.data());
 
-	for (auto& value : positions) {
-		value = glm::vec3(-1);
-	}
+	//central differences on the full resolution heights : normal = (-dx * sizeY, 2 * sizeX * sizeY, -dz * sizeX)
+	const LengthType normalY = 2.f * data_.primitiveSize.x * data_.primitiveSize.y;
 
-	fillPositions(positions, heightmap, chunkPosition);
-	fillTriangles(quads, positions);
-
-	result.vertices.resize((size_t)size.x * size.y);
-	for (size_t j = 0; j < size.y; j++)
+	result.vertices.resize((size_t)coarseSize.x * coarseSize.y);
+	TerrainVertex* vertex = result.vertices.data();
+	for (int j = 0; j < coarseSize.y; j++)
 	{
-		for (size_t i = 0; i < size.x; i++) 
-		{
-			const glm::vec3 normal =
-				quads.value(i, j).triangle_d.normal +
-				quads.value(i + 1, j).triangle_c.normal +
-				quads.value(i, j + 1).triangle_b.normal +
-				quads.value(i + 1, j + 1).triangle_a.normal;
-				
-			result.vertices.emplace(result.vertices.begin() + TWO_DIM(i,j, size.x), positions.value(i + 1, j + 1), normal);
-		}
-	}
+		const int y = j * stride;
+		const HeightType* row = padded.data() + ((size_t)y + 1) * paddedWidth + 1;
 
-	result.indices.resize(((size_t)size.x - 1) * ((size_t)size.y - 1) * 6);
+		for (int i = 0; i < coarseSize.x; i++, vertex++)
+		{
+			const int x = i * stride;
 
+			const HeightType dx = row[x + 1] - row[x - 1];
+			const HeightType dz = row[x + paddedWidth] - row[x - (ptrdiff_t)paddedWidth];
 
-	unsigned index = 0;
-	for (int j = 0; j < size.y - 1; j++)
-	{
-		for (int i = 0; i < size.x - 1; i++)
-		{
-			const unsigned a = TWO_DIM(i + 0, j + 0, size.x);
-			const unsigned b = TWO_DIM(i + 1, j + 0, size.x);
-			const unsigned c = TWO_DIM(i + 0, j + 1, size.x);
-			const unsigned d = TWO_DIM(i + 1, j + 1, size.x);
-
-			result.indices.emplace(result.indices.begin() + index + 0, a);
-			result.indices.emplace(result.indices.begin() + index + 1, c);
-			result.indices.emplace(result.indices.begin() + index + 2, b);
-			result.indices.emplace(result.indices.begin() + index + 3, b);
-			result.indices.emplace(result.indices.begin() + index + 4, c);
-			result.indices.emplace(result.indices.begin() + index + 5, d);
-
-			index += 6;
+			*vertex = TerrainVertex(x, y, row[x], glm::vec3(-dx * data_.primitiveSize.y, normalY, -dz * data_.primitiveSize.x));
 		}
 	}
 
-	/*for (size_t i = 0; i < positions.x(); i++)
-	{
-		Debug::get() << i << " : \t";
-		for (size_t j = 0; j < positions.y(); j++)
-		{
-			Debug::get() << to_string((glm::ivec3)positions.value(i, j)) << "\t\t";
-		}
-		Debug::get() << '\n';
-	}*/
-	Debug::get().log();
+	//all the chunks of this level of detail have the same triangles
+	result.indices.clear();
+	result.sharedIndices = topologies_[levelOf(stride)];
 }
 
-glm::vec3 ns::Plane::MeshGenerator::VertexWorldPosition(const MapLengthType& chunkPos, float height, int x, int y)
+void ns::Plane::MeshGenerator::fillPaddedHeights(const MeshGenerator::Input& heightmap, HeightType* padded) const
 {
-	return glm::vec3( chunkPos.x + x * data_.primitiveSize.x, height, chunkPos.y + y * data_.primitiveSize.y);
+	const size_t width = heightMapSettings_.numberOfPartitions.x + 1;
+	const size_t height = heightMapSettings_.numberOfPartitions.y + 1;
+	const size_t paddedWidth = width + 2;
+
+	const std::vector<HeightType>& bottom = heightmap.neighbors[Input::bottom]->heights;
+	const std::vector<HeightType>& top = heightmap.neighbors[Input::top]->heights;
+	const std::vector<HeightType>& left = heightmap.neighbors[Input::left]->heights;
+	const std::vector<HeightType>& right = heightmap.neighbors[Input::right]->heights;
+
+	std::copy(bottom.begin(), bottom.begin() + width, padded + 1);
+	std::copy(top.begin(), top.begin() + width, padded + (height + 1) * paddedWidth + 1);
+
+	for (size_t j = 0; j < height; j++)
+	{
+		HeightType* row = padded + (j + 1) * paddedWidth;
+		row[0] = left[j];
+		row[width + 1] = right[j];
+
+		if (heightmap.values)
+			std::copy(&heightmap.values->value(0, (uint32_t)j), &heightmap.values->value(0, (uint32_t)j) + width, row + 1);
+		else
+			for (size_t i = 0; i < width; i++)
+				row[i + 1] = heightmap.height((uint32_t)i, (uint32_t)j);
+	}
 }
 
-void ns::Plane::MeshGenerator::fillPositions(ns::BiArray<glm::vec3>& positions, const MeshGenerator::Input& heightmap, const MapLengthType chunkPosition)
+void ns::Plane::MeshGenerator::genTopology(unsigned stride, std::vector<unsigned>& indices) const
 {
-	const glm::ivec2 size(heightMapSettings_.numberOfPartitions.x + 1, heightMapSettings_.numberOfPartitions.y + 1);
+	const glm::ivec2 coarseSize(heightMapSettings_.numberOfPartitions.x / stride + 1, heightMapSettings_.numberOfPartitions.y / stride + 1);
 
-	for (size_t i = 0; i < size.x; i++)
+	indices.clear();
+	indices.reserve(((size_t)coarseSize.x - 1) * ((size_t)coarseSize.y - 1) * 6);
+	for (int j = 0; j < coarseSize.y - 1; j++)
 	{
-		for (size_t j = 0; j < size.y; j++)
+		for (int i = 0; i < coarseSize.x - 1; i++)
 		{
-			positions.value(i + 1, j + 1) = VertexWorldPosition(chunkPosition, heightmap.values[TWO_DIM(i, j, size.x)], i, j);
+			const unsigned a = TWO_DIM(i + 0, j + 0, coarseSize.x);
+			const unsigned b = TWO_DIM(i + 1, j + 0, coarseSize.x);
+			const unsigned c = TWO_DIM(i + 0, j + 1, coarseSize.x);
+			const unsigned d = TWO_DIM(i + 1, j + 1, coarseSize.x);
+
+			indices.insert(indices.end(), { a, c, b, b, c, d });
 		}
 	}
 
-	checkNeighborsLinesXandZ(heightmap, chunkPosition);
+	//the skirt vertices are after the grid vertices, in the order of genBorder()
+	std::vector<glm::ivec2> border;
+	genBorder(stride, border);
 
-	for (size_t i = 0; i < size.x; i++) {
-		positions.value(i + 1, 0) = heightmap.neighbors[Input::bottom]->positions[i];
-		positions.value(i + 1, positions.y() - 1) = heightmap.neighbors[Input::top]->positions[i];
-	}
+	const unsigned firstSkirtVertex = (unsigned)coarseSize.x * coarseSize.y;
+	for (size_t k = 0; k < border.size(); k++)
+	{
+		const size_t next = (k + 1) % border.size();
+		const unsigned a = TWO_DIM(border[k].x / stride, border[k].y / stride, (unsigned)coarseSize.x);
+		const unsigned b = TWO_DIM(border[next].x / stride, border[next].y / stride, (unsigned)coarseSize.x);
+		const unsigned lowA = firstSkirtVertex + (unsigned)k;
+		const unsigned lowB = firstSkirtVertex + (unsigned)next;
 
-	for (size_t j = 0; j < size.y; j++) {
-		positions.value(0, j + 1) = heightmap.neighbors[Input::left]->positions[j];
-		positions.value(positions.x() - 1, j + 1) = heightmap.neighbors[Input::right]->positions[j];
+		indices.insert(indices.end(), { a, b, lowA, b, lowB, lowA });
 	}
 }
 
-void ns::Plane::MeshGenerator::fillTriangles(BiArray<MeshGenerator::Quad>& quads, const ns::BiArray<glm::vec3>& positions)
+void ns::Plane::MeshGenerator::genBorder(unsigned stride, std::vector<glm::ivec2>& border) const
 {
-#	ifndef NDEBUG
-	//check triangles array size
-	_STL_VERIFY(quads.x() == positions.x() - 1, "fillTriangles() error : quad array has an invalid size !");
-	_STL_VERIFY(quads.y() == positions.y() - 1, "fillTriangles() error : quad array has an invalid size !");
-#	endif // !NDEBUG
+	const glm::ivec2 size(heightMapSettings_.numberOfPartitions.x + 1, heightMapSettings_.numberOfPartitions.y + 1);
 
-	for (size_t j = 0; j < quads.y(); j++)
-	{
-		for (size_t i = 0; i < quads.x(); i++)
-		{
-			//create the triangles
-			quads.emplace(i, j, Quad(positions.index(i, j), positions.index(i + 1, j), positions.index(i, j + 1), positions.index(i + 1, j + 1)));
-
-			//generate the normals of the triangles
-			quads.value(i, j).triangle_a.genNormal(positions.data());
-			quads.value(i, j).triangle_b.genNormal(positions.data());
-			quads.value(i, j).triangle_c.genNormal(positions.data());
-			quads.value(i, j).triangle_d.genNormal(positions.data());
-		}
-	}
+	//border vertices going around the chunk counterclockwise (seen from above) so the skirts face the outside
+	border.clear();
+	for (int i = 0; i < size.x - 1; i += stride) border.emplace_back(i, 0);
+	for (int j = 0; j < size.y - 1; j += stride) border.emplace_back(size.x - 1, j);
+	for (int i = size.x - 1; i > 0; i -= stride) border.emplace_back(i, size.y - 1);
+	for (int j = size.y - 1; j > 0; j -= stride) border.emplace_back(0, j);
 }
 
-void ns::Plane::MeshGenerator::checkNeighborsLinesXandZ(const MeshGenerator::Input& heightmap, const MapLengthType chunkPosition)
+unsigned ns::Plane::MeshGenerator::levelOf(unsigned stride)
 {
-	const glm::ivec2 size(heightMapSettings_.numberOfPartitions.x + 1, heightMapSettings_.numberOfPartitions.y + 1);
+	unsigned level = 0;
+	while ((1U << level) < stride) level++;
+	return level;
+}
 
-	//check left
-	HeightmapStorage::NeighborChunkLine* line = heightmap.neighbors[HeightmapStorage::Result::left];
-	if (!line->xzComputed) {
-		for (size_t j = 0; j < size.y; j++)
-		{
-			line->positions[j] = VertexWorldPosition(chunkPosition, line->positions[j].y, -1, j);
-		}
-		line->xzComputed = true;
-	}
+void ns::Plane::MeshGenerator::addSkirts(const MeshGenerator::Input& heightmap, Result& result, unsigned stride)
+{
+	const MapLengthType origin(0);
+	const size_t coarseWidth = heightMapSettings_.numberOfPartitions.x / stride + 1;
+	const LengthType depth = skirtDepth(heightmap);
+
+	thread_local std::vector<glm::ivec2> border;
+	genBorder(stride, border);
 
-	//check right
-	line = heightmap.neighbors[HeightmapStorage::Result::right];
-	if (!line->xzComputed){
-		for (size_t j = 0; j < size.y; j++)
+	if (result.indexed) {
+		//the skirt vertices use the normals of the border vertices so the lighting doesn't change at the border
+		//(their triangles are in the shared topology)
+		for (const auto& vertex : border)
 		{
-			line->positions[j] = VertexWorldPosition(chunkPosition, line->positions[j].y, size.x, j);
+			TerrainVertex skirt = result.vertices[TWO_DIM(vertex.x / stride, vertex.y / stride, coarseWidth)];
+			skirt.height -= depth;
+			result.vertices.push_back(skirt);
 		}
-		line->xzComputed = true;
 	}
-
-	//check bottom
-	line = heightmap.neighbors[HeightmapStorage::Result::bottom];
-	if (!line->xzComputed) {
-		for (size_t i = 0; i < size.x; i++)
+	else {
+		for (size_t k = 0; k < border.size(); k++)
 		{
-			line->positions[i] = VertexWorldPosition(chunkPosition, line->positions[i].y, i, -1);
+			const glm::ivec2& first = border[k];
+			const glm::ivec2& second = border[(k + 1) % border.size()];
+
+			const glm::vec3 a(VertexWorldPosition(origin, heightmap.height(first.x, first.y), first.x, first.y));
+			const glm::vec3 b(VertexWorldPosition(origin, heightmap.height(second.x, second.y), second.x, second.y));
+			const glm::vec3 lowA(a.x, a.y - depth, a.z);
+
+			Triangle triangle(a, b, lowA);
+			triangle.genNormal();
+
+			result.vertices.emplace_back(first.x, first.y, a.y, triangle.normal);
+			result.vertices.emplace_back(second.x, second.y, b.y, triangle.normal);
+			result.vertices.emplace_back(first.x, first.y, a.y - depth, triangle.normal);
+			result.vertices.emplace_back(second.x, second.y, b.y, triangle.normal);
+			result.vertices.emplace_back(second.x, second.y, b.y - depth, triangle.normal);
+			result.vertices.emplace_back(first.x, first.y, a.y - depth, triangle.normal);
 		}
-		line->xzComputed = true;
 	}
+}
 
-	//check top
-	line = heightmap.neighbors[HeightmapStorage::Result::top];
-	if (!line->xzComputed) {
-		for (size_t i = 0; i < size.x; i++)
-		{
-			line->positions[i] = VertexWorldPosition(chunkPosition, line->positions[i].y, i, size.y);
-		}
-		line->xzComputed = true;
+ns::LengthType ns::Plane::MeshGenerator::skirtDepth(const MeshGenerator::Input& heightmap) const
+{
+	const glm::ivec2 size(heightMapSettings_.numberOfPartitions.x + 1, heightMapSettings_.numberOfPartitions.y + 1);
+
+	//a crack is at most the distance between the full resolution border and the border of a lower level of detail
+	LengthType ret = 0;
+	for (unsigned level = 1; level < numberOfLevels(); level++)
+	{
+		const int stride = 1 << level;
+
+		const auto checkEdge = [&](int length, auto height) {
+			for (int k = 0; k < length; k++)
+			{
+				const int previous = k / stride * stride;
+				const int next = std::min(previous + stride, length - 1);
+				const LengthType t = (LengthType)(k - previous) / stride;
+				ret = std::max(ret, std::abs(height(k) - glm::mix(height(previous), height(next), t)));
+			}
+		};
+
+		checkEdge(size.x, [&](int i) { return heightmap.height(i, 0); });
+		checkEdge(size.x, [&](int i) { return heightmap.height(i, size.y - 1); });
+		checkEdge(size.y, [&](int j) { return heightmap.height(0, j); });
+		checkEdge(size.y, [&](int j) { return heightmap.height(size.x - 1, j); });
 	}
+
+	//a small margin hide the gaps due to the rounding
+	return ret + data_.primitiveSize.x * .1f;
+}
+
+glm::vec3 ns::Plane::MeshGenerator::VertexWorldPosition(const MapLengthType& chunkPos, float height, int x, int y)
+{
+	return glm::vec3( chunkPos.x + x * data_.primitiveSize.x, height, chunkPos.y + y * data_.primitiveSize.y);
 }
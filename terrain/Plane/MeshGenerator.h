@@ -20,8 +20,9 @@ namespace ns::Plane {
 	{
 	public:
 		struct Result {
-			std::vector<Vertex> vertices;
+			std::vector<TerrainVertex> vertices;		//vertices relative to the chunk origin (see chunkOrigin() and vertexLayout())
 			std::vector<unsigned> indices;
+			std::shared_ptr<const std::vector<unsigned>> sharedIndices;	//indices shared by all the chunks with the same level of detail (indices is empty when it is used)
 			GLint primitiveType = GL_TRIANGLES;
 			bool indexed = true;
 		};
@@ -39,7 +40,23 @@ namespace ns::Plane {
 	public:
 
 		MeshGenerator(const HeightmapStorage& heightmapGeneratorUsed, const MeshGenerator::Settings& settings = MeshGenerator::Settings());
-		void operator()(const Input& heightmap, Result& result);
+		/**
+		 * @brief generate the mesh of a chunk
+		 * the level of detail n only use one vertex every 2^n partitions, the chunk borders have skirts that hide the cracks
+		 * between chunks that have different levels of detail
+		 * \param heightmap heights of the chunk
+		 * \param result output mesh
+		 * \param levelOfDetail 0 is the full resolution, it is clamped to numberOfLevels() - 1
+		 */
+		void operator()(const Input& heightmap, Result& result, unsigned levelOfDetail = 0);
+		//number of levels of detail that the partitions allow (a level must divide the number of partitions)
+		unsigned numberOfLevels() const;
+		//format of the vertices of the results
+		VertexLayout vertexLayout() const;
+		//world position of the (0, 0) vertex of a chunk, the meshes must be drawn at this position
+		MapLengthType chunkOrigin(const GridPositionType& chunk) const;
+		//indices of the smooth meshes of a level of detail, the same vector is given to all the results of this level
+		const std::shared_ptr<const std::vector<unsigned>>& topology(unsigned levelOfDetail) const;
 
 		//store a triangle and it's normal
 		struct Triangle {
@@ -70,69 +87,29 @@ namespace ns::Plane {
 			glm::vec3 normal;
 		};
 
-		//store a triangle under the shape of indices and store a normal vector
-		struct IndexedTriangle
-		{
-			IndexedTriangle(
-				unsigned pAIndex = NullIndex,
-				unsigned pBIndex = NullIndex,
-				unsigned pCIndex = NullIndex,
-				const glm::vec3 normal = { 0, 1, 0 })
-				:
-				a(pAIndex),
-				b(pBIndex),
-				c(pCIndex),
-				normal(normal)
-			{}
-
-			void genNormal(const glm::vec3* arrayOfVertices) {
-				const glm::vec3 U = arrayOfVertices[b] - arrayOfVertices[a];
-				const glm::vec3 V = arrayOfVertices[c] - arrayOfVertices[a];
-
-				normal.x = (U.y * V.z) - (U.z * V.y);
-				normal.y = (U.z * V.x) - (U.x * V.z);
-				normal.z = (U.x * V.y) - (U.y * V.x);
-			}
-
-			static constexpr unsigned NullIndex = UINT_MAX;
-
-			unsigned a;
-			unsigned b;
-			unsigned c;
-			glm::vec3 normal;
-		};
-
-		struct Quad {
-			Quad() :
-				triangle_a(),
-				triangle_b(),
-				triangle_c(),
-				triangle_d()
-			{}
-			Quad(unsigned a, unsigned b, unsigned c, unsigned d) :
-				triangle_a(a, c, b),
-				triangle_d(d, b, c),
-				triangle_b(b, a, d),
-				triangle_c(c, d, a)
-			{}
-			IndexedTriangle triangle_a, triangle_b, triangle_c, triangle_d;// the triangle letter is the point where the triangle has a 90 degrees angle the quad is A B D C
-		};
-
 	protected:
 		const Settings settings_;
 		const HeightmapStorage::Settings heightMapSettings_;
 		const HeightmapStorage::preComputedValues data_;
+		std::vector<std::shared_ptr<const std::vector<unsigned>>> topologies_;	//indices of each level of detail
 
 	protected:
-		void genFlatNormalsMesh(const MeshGenerator::Input& heightmap, Result& result, const MapLengthType& chunkPosition);
-		void genSmoothNormalsMesh(const MeshGenerator::Input& heightmap, Result& result, const MapLengthType& chunkPosition);
+		void genFlatNormalsMesh(const MeshGenerator::Input& heightmap, Result& result, unsigned stride);
+		//smooth mesh that use one vertex every stride partitions, the normals are computed with the full resolution heights
+		void genSmoothNormalsMesh(const MeshGenerator::Input& heightmap, Result& result, unsigned stride);
+		//copy the heights of the chunk and of its neighbor lines in a (width + 2) * (height + 2) array (the corners are not written)
+		void fillPaddedHeights(const MeshGenerator::Input& heightmap, HeightType* padded) const;
+		//indices of the grid and of the skirts of a level of detail
+		void genTopology(unsigned stride, std::vector<unsigned>& indices) const;
+		//border vertices of a level of detail, in the order used by the skirts
+		void genBorder(unsigned stride, std::vector<glm::ivec2>& border) const;
+		static unsigned levelOf(unsigned stride);
+		//add vertical triangles under the borders of the chunk
+		void addSkirts(const MeshGenerator::Input& heightmap, Result& result, unsigned stride);
+		//maximum gap between the borders of two chunks with different levels of detail
+		LengthType skirtDepth(const MeshGenerator::Input& heightmap) const;
 
 		glm::vec3 VertexWorldPosition(const MapLengthType& chunkWorldPos, float height, int PrimitiveOffsetX, int PrimitiveOffsetY);
-
-		void fillPositions(ns::BiArray<glm::vec3>& positions, const MeshGenerator::Input& heightmap, const MapLengthType chunkWorldPosition);
-		void fillTriangles(BiArray<MeshGenerator::Quad>& quads, const ns::BiArray<glm::vec3>& positions);
-
-		void checkNeighborsLinesXandZ(const MeshGenerator::Input& heightmap, const MapLengthType chunkWorldPosition);
 	};
 }
 
@@ -0,0 +1,50 @@
+#include "NeighborLineStore.h"
+
+ns::Plane::NeighborLineStore::NeighborLineStore()
+{
+	for (auto& shard : shards_)
+		shard = std::make_shared<Shard>();
+}
+
+std::shared_ptr<ns::Plane::NeighborChunkLine> ns::Plane::NeighborLineStore::acquire(const GridPositionType& chunkPos, const GridPositionType& neighborChunk)
+{
+	const std::shared_ptr<Shard> owner = shards_[shardIndex(chunkPos, neighborChunk)];
+
+	std::scoped_lock lock(owner->mutex);
+
+	NeighborChunkLine* slot;
+	if (owner->freeSlots.size()) {
+		slot = owner->freeSlots.back();
+		owner->freeSlots.pop_back();
+	}
+	else {
+		slot = &owner->slots.emplace_back();
+	}
+
+	//a reused slot keep the capacity of its heights so filling it doesn't allocate
+	slot->chunkPos = chunkPos;
+	slot->neighborChunk = neighborChunk;
+
+	return std::shared_ptr<NeighborChunkLine>(slot, [owner](NeighborChunkLine* released) {
+		std::scoped_lock lock(owner->mutex);
+		owner->freeSlots.push_back(released);
+	});
+}
+
+size_t ns::Plane::NeighborLineStore::size() const
+{
+	size_t ret = 0;
+	for (const auto& s : shards_)
+	{
+		std::scoped_lock lock(s->mutex);
+		ret += s->slots.size() - s->freeSlots.size();
+	}
+	return ret;
+}
+
+size_t ns::Plane::NeighborLineStore::shardIndex(const GridPositionType& chunkPos, const GridPositionType& neighborChunk)
+{
+	const size_t a = std::hash<int64_t>()(((int64_t)chunkPos.x << 32) ^ (uint32_t)chunkPos.y);
+	const size_t b = std::hash<int64_t>()(((int64_t)neighborChunk.x << 32) ^ (uint32_t)neighborChunk.y);
+	return (a ^ (b + 0x9e3779b9 + (a << 6) + (a >> 2))) % numberOfShards;
+}
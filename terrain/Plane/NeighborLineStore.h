@@ -0,0 +1,60 @@
+#pragma once
+
+//noisy
+#include <configNoisy.hpp>
+
+//stl
+#include <vector>
+#include <array>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+
+//glm
+#include <glm/glm.hpp>
+
+namespace ns::Plane {
+	struct NeighborChunkLine {
+		std::vector<HeightType> heights;	//heights of the line of vertices, their x and z are computed by the meshGenerator
+		GridPositionType chunkPos;			//chunk where the vertices are
+		GridPositionType neighborChunk;		//chunk that is really close to these vertices
+	};
+
+	/**
+	 * @brief allocate the neighbor lines computed by the HeightmapStorage.
+	 * lines are allocated in pools that never move them, and a line goes back to its pool when the last chunk holding it
+	 * releases it, so the memory of the unloaded chunks lines is reused by the next ones. The pool is split in shards
+	 * (selected with the chunk position) so the loading threads rarely wait for each other when they take lines.
+	 */
+	class NeighborLineStore
+	{
+	public:
+		NeighborLineStore();
+		/**
+		 * @brief take a line from the pool (its heights still need to be filled)
+		 * \param chunkPos chunk where the vertices are
+		 * \param neighborChunk chunk that is really close to these vertices
+		 * \return a pointer to the line, it goes back to the pool when the last copy is released
+		 */
+		std::shared_ptr<NeighborChunkLine> acquire(const GridPositionType& chunkPos, const GridPositionType& neighborChunk);
+		/**
+		 * @brief return the number of lines currently held outside the pool
+		 */
+		size_t size() const;
+
+		static constexpr size_t numberOfShards = 16;
+
+	protected:
+		struct Shard {
+			mutable std::mutex mutex;
+			std::deque<NeighborChunkLine> slots;			//pool of lines, a deque never moves its elements when it grows
+			std::vector<NeighborChunkLine*> freeSlots;		//lines of the pool that can be reused
+		};
+
+		static size_t shardIndex(const GridPositionType& chunkPos, const GridPositionType& neighborChunk);
+
+		//shards are shared with the lines deleters so a line can go back to its pool after the store is destroyed
+		std::array<std::shared_ptr<Shard>, numberOfShards> shards_;
+	};
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include <configNoisy.hpp>
+#include "HeightMapGenerator.h"
+
+//stl
+#include <array>
+#include <memory>
+#include <utility>
+
+namespace ns::Plane {
+	template<unsigned exponent, bool... ridged>
+	/**
+	 * @brief height map generator whose number of octaves, ridged flags and exponent are fixed at compile time.
+	 * The octave loop is unrolled, the ridged test is removed and pow is replaced by multiplications.
+	 * It can be converted into a HeightMapGenerator to be used by the HeightmapStorage (the debug builds then check its heights
+	 * against the runtime generator of the same settings, see TerrainBenchmark::defaultGenerator()) :
+	 * 
+	 * StaticHeightMapGenerator<1, false, true> generator({ { {.05, 5, 5.5}, {.2, 20, -.6} } });
+	 * HeightmapStorage::Settings settings(generator);
+	 */
+	class StaticHeightMapGenerator : public HeightMapGenerator::Evaluator
+	{
+	public:
+		static_assert(sizeof...(ridged) > 0, "a height map generator needs at least one octave");
+		static_assert(exponent > 0, "the exponent of a static height map generator must be positive");
+
+		static constexpr size_t numberOfOctaves = sizeof...(ridged);
+
+		//the ridged member of the octaves is ignored, the template arguments are used instead
+		StaticHeightMapGenerator(const std::array<HeightMapGenerator::Octave, numberOfOctaves>& octaves)
+			:
+			octaves_(octaves)
+		{
+			constexpr std::array<bool, numberOfOctaves> flags{ ridged... };
+
+			inversedAmplitudeRect_ = 0;
+			for (size_t i = 0; i < numberOfOctaves; i++)
+			{
+				octaves_[i].ridged = flags[i];
+				inversedAmplitudeRect_ += octaves_[i].amplitude;
+			}
+
+			inversedAmplitudeRect_ = 1 / inversedAmplitudeRect_;
+		}
+
+		//create a type-erased generator that use this one
+		operator HeightMapGenerator() const
+		{
+			return HeightMapGenerator(std::make_shared<StaticHeightMapGenerator>(*this));
+		}
+
+		virtual HeightMapGenerator::Settings settings() const override
+		{
+			return HeightMapGenerator::Settings{ std::vector<HeightMapGenerator::Octave>(octaves_.begin(), octaves_.end()), static_cast<double>(exponent) };
+		}
+
+		virtual HeightType operator()(const MapLengthType& pos) const override
+		{
+			return power(sum(pos, std::make_index_sequence<numberOfOctaves>()) * inversedAmplitudeRect_);
+		}
+
+		virtual void operator()(const MapLengthType& start, const MapLengthType& step, size_t count, HeightType* output) const override
+		{
+			thread_local std::vector<LengthType> xs, ys;
+			thread_local std::vector<HeightType> noise;
+			xs.resize(count);
+			ys.resize(count);
+			noise.resize(count);
+
+			for (size_t i = 0; i < count; i++)
+				output[i] = 0;
+
+			batchSum(start, step, count, output, xs.data(), ys.data(), noise.data(), std::make_index_sequence<numberOfOctaves>());
+
+			for (size_t i = 0; i < count; i++)
+				output[i] = power(output[i] * inversedAmplitudeRect_);
+		}
+
+	protected:
+		std::array<HeightMapGenerator::Octave, numberOfOctaves> octaves_;
+		HeightType inversedAmplitudeRect_;
+
+	protected:
+		template<bool isRidged>
+		HeightType octave(const MapLengthType& pos, const HeightMapGenerator::Octave& octave) const
+		{
+			if constexpr (isRidged)
+				return ridgedSimplexNoise(pos * octave.frequency + octave.offset) * octave.amplitude;
+			else
+				return simplexNoise(pos * octave.frequency + octave.offset) * octave.amplitude;
+		}
+
+		template<size_t... index>
+		HeightType sum(const MapLengthType& pos, std::index_sequence<index...>) const
+		{
+			return (octave<ridged>(pos, octaves_[index]) + ...);
+		}
+
+		template<bool isRidged>
+		void batchOctave(const MapLengthType& start, const MapLengthType& step, size_t count, HeightType* output,
+			LengthType* xs, LengthType* ys, HeightType* noise, const HeightMapGenerator::Octave& octave) const
+		{
+			for (size_t i = 0; i < count; i++)
+			{
+				xs[i] = (start.x + i * step.x) * octave.frequency + octave.offset;
+				ys[i] = (start.y + i * step.y) * octave.frequency + octave.offset;
+			}
+
+			if constexpr (isRidged)
+				ridgedSimplexNoise(xs, ys, count, noise);
+			else
+				simplexNoise(xs, ys, count, noise);
+
+			for (size_t i = 0; i < count; i++)
+				output[i] += noise[i] * octave.amplitude;
+		}
+
+		template<size_t... index>
+		void batchSum(const MapLengthType& start, const MapLengthType& step, size_t count, HeightType* output,
+			LengthType* xs, LengthType* ys, HeightType* noise, std::index_sequence<index...>) const
+		{
+			(batchOctave<ridged>(start, step, count, output, xs, ys, noise, octaves_[index]), ...);
+		}
+
+		//pow(value, exponent) unrolled into multiplications
+		static HeightType power(HeightType value)
+		{
+			if constexpr (exponent == 1)
+				return value;
+			else if constexpr (exponent == 2)
+				return value * value;
+			else {
+				HeightType ret = value;
+				for (unsigned i = 1; i < exponent; i++)
+					ret *= value;
+				return ret;
+			}
+		}
+	};
+}
@@ -0,0 +1,352 @@
+#include "PlanetGenerator.h"
+#include <Utils/SimdLanes.h>
+
+//stl
+#include <array>
+#include <cmath>
+
+ns::Sphere::PlanetGenerator::PlanetGenerator(const Settings& settings)
+	:
+	settings_(settings)
+{
+	inversedAmplitudeRect_ = 0;
+	for (const auto& octave : settings_.octaves) {
+		inversedAmplitudeRect_ += octave.amplitude;
+	}
+
+	inversedAmplitudeRect_ = 1 / inversedAmplitudeRect_;
+}
+
+ns::Sphere::PlanetGenerator::Settings ns::Sphere::PlanetGenerator::defaultSettings()
+{
+	Settings ret;
+	ret.octaves = {
+		{ 1.1_lt, .02_lt, 0, false },
+		{ 10._lt, .01_lt, 0, false }
+	};
+	ret.exponent = 1.0;
+	ret.elevation = .03_ht;
+	ret.chunkResolution = 20;
+	return ret;
+}
+
+const ns::Sphere::PlanetGenerator::Settings& ns::Sphere::PlanetGenerator::settings() const
+{
+	return settings_;
+}
+
+ns::HeightType ns::Sphere::PlanetGenerator::operator()(const glm::vec3& direction) const
+{
+	HeightType ret = 0;
+
+	for (const auto& octave : settings_.octaves) {
+		if (octave.ridged)
+			ret += ridgedSimplexNoise(direction * octave.frequency + octave.offset) * octave.amplitude;
+		else
+			ret += simplexNoise(direction * octave.frequency + octave.offset) * octave.amplitude;
+	}
+
+	return shape(ret * inversedAmplitudeRect_);
+}
+
+void ns::Sphere::PlanetGenerator::operator()(const glm::vec3* directions, size_t count, HeightType* output) const
+{
+	//buffers are kept by each thread to avoid allocations between two chunks
+	thread_local std::vector<LengthType> xs, ys, zs;
+	thread_local std::vector<HeightType> noise;
+	xs.resize(count);
+	ys.resize(count);
+	zs.resize(count);
+	noise.resize(count);
+
+	for (size_t i = 0; i < count; i++)
+		output[i] = 0;
+
+	for (const auto& octave : settings_.octaves) {
+		for (size_t i = 0; i < count; i++)
+		{
+			xs[i] = directions[i].x * octave.frequency + octave.offset;
+			ys[i] = directions[i].y * octave.frequency + octave.offset;
+			zs[i] = directions[i].z * octave.frequency + octave.offset;
+		}
+
+		if (octave.ridged)
+			ridgedSimplexNoise(xs.data(), ys.data(), zs.data(), count, noise.data());
+		else
+			simplexNoise(xs.data(), ys.data(), zs.data(), count, noise.data());
+
+		for (size_t i = 0; i < count; i++)
+			output[i] += noise[i] * octave.amplitude;
+	}
+
+	for (size_t i = 0; i < count; i++)
+		output[i] = shape(output[i] * inversedAmplitudeRect_);
+
+#	ifndef NDEBUG
+	//the first sample is computed by the SIMD lanes and the last one often by the scalar tail, both must match the scalar function
+	if (count) {
+		_STL_ASSERT(std::abs(output[0] - (*this)(directions[0])) <= batchTolerance, "the batched elevations differ from the scalar function");
+		_STL_ASSERT(std::abs(output[count - 1] - (*this)(directions[count - 1])) <= batchTolerance, "the batched elevations differ from the scalar function");
+	}
+#	endif // !NDEBUG
+}
+
+ns::HeightType ns::Sphere::PlanetGenerator::shape(HeightType height) const
+{
+	//the noise is signed (oceans are under the radius) so the exponent keeps the sign
+	if (settings_.exponent != 1.0)
+		height = static_cast<HeightType>(std::copysign(std::pow(std::abs(height), settings_.exponent), height));
+
+	return height * settings_.elevation;
+}
+
+
+//SIMPLEX NOISE 3D
+//
+//global constants
+
+namespace {
+	constexpr std::array<int, 256> perm = { 151,160,137,91,90,15,
+		131,13,201,95,96,53,194,233,7,225,140,36,103,30,69,142,8,99,37,240,21,10,23,
+		190, 6,148,247,120,234,75,0,26,197,62,94,252,219,203,117,35,11,32,57,177,33,
+		88,237,149,56,87,174,20,125,136,171,168, 68,175,74,165,71,134,139,48,27,166,
+		77,146,158,231,83,111,229,122,60,211,133,230,220,105,92,41,55,46,245,40,244,
+		102,143,54, 65,25,63,161, 1,216,80,73,209,76,132,187,208, 89,18,169,200,196,
+		135,130,116,188,159,86,164,100,109,198,173,186, 3,64,52,217,226,250,124,123,
+		5,202,38,147,118,126,255,82,85,212,207,206,59,227,47,16,58,17,182,189,28,42,
+		223,183,170,213,119,248,152, 2,44,154,163, 70,221,153,101,155,167, 43,172,9,
+		129,22,39,253, 19,98,108,110,79,113,224,232,178,185, 112,104,218,246,97,228,
+		251,34,242,193,238,210,144,12,191,179,162,241, 81,51,145,235,249,14,239,107,
+		49,192,214, 31,181,199,106,157,184, 84,204,176,115,121,50,45,127, 4,150,254,
+		138,236,205,93,222,114,67,29,24,72,243,141,128,195,78,66,215,61,156,180 };
+
+	constexpr float F3 = 1.f / 3.f;
+	constexpr float G3 = 1.f / 6.f;
+
+	//the 16 gradients of the improved perlin noise: (+-u, +-v) where u and v are two different axes chosen by the hash
+	struct Gradients {
+		std::array<float, 16> x{}, y{}, z{};
+	};
+
+	constexpr Gradients gradients = []() {
+		Gradients ret;
+		for (int h = 0; h < 16; h++)
+		{
+			const int u = h < 8 ? 0 : 1;
+			const int v = h < 4 ? 1 : (h == 12 or h == 14) ? 0 : 2;
+			std::array<float, 3> g{};
+			g[u] += (h & 1) ? -1.f : 1.f;
+			g[v] += (h & 2) ? -1.f : 1.f;
+			ret.x[h] = g[0];
+			ret.y[h] = g[1];
+			ret.z[h] = g[2];
+		}
+		return ret;
+	}();
+
+	inline int hash(int i)
+	{
+		return perm[i & 255];
+	}
+
+	inline int floorToInt(float value)
+	{
+		const int i = static_cast<int>(value);
+		return (value < i) ? (i - 1) : i;
+	}
+
+	//contribution of one corner of the simplex
+	inline float corner(float x, float y, float z, int gradientIndex)
+	{
+		float t = .6f - x * x - y * y - z * z;
+		if (t < 0) return 0.f;
+
+		t *= t;
+		const int h = gradientIndex & 15;
+		return t * t * (gradients.x[h] * x + gradients.y[h] * y + gradients.z[h] * z);
+	}
+}
+
+ns::HeightType ns::Sphere::simplexNoise(const glm::vec3& in)
+{
+	const float s = (in.x + in.y + in.z) * F3;
+	const int i = floorToInt(in.x + s);
+	const int j = floorToInt(in.y + s);
+	const int k = floorToInt(in.z + s);
+
+	const float t = (i + j + k) * G3;
+	const float x0 = in.x - (i - t);
+	const float y0 = in.y - (j - t);
+	const float z0 = in.z - (k - t);
+
+	//second and third corners of the simplex, found by ranking the coordinates
+	int i1, j1, k1;
+	int i2, j2, k2;
+
+	if (x0 >= y0) {
+		if (y0 >= z0) {
+			i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 1; k2 = 0;
+		}
+		else if (x0 >= z0) {
+			i1 = 1; j1 = 0; k1 = 0; i2 = 1; j2 = 0; k2 = 1;
+		}
+		else {
+			i1 = 0; j1 = 0; k1 = 1; i2 = 1; j2 = 0; k2 = 1;
+		}
+	}
+	else {
+		if (y0 < z0) {
+			i1 = 0; j1 = 0; k1 = 1; i2 = 0; j2 = 1; k2 = 1;
+		}
+		else if (x0 < z0) {
+			i1 = 0; j1 = 1; k1 = 0; i2 = 0; j2 = 1; k2 = 1;
+		}
+		else {
+			i1 = 0; j1 = 1; k1 = 0; i2 = 1; j2 = 1; k2 = 0;
+		}
+	}
+
+	const float n0 = corner(x0, y0, z0, hash(i + hash(j + hash(k))));
+	const float n1 = corner(x0 - i1 + G3, y0 - j1 + G3, z0 - k1 + G3, hash(i + i1 + hash(j + j1 + hash(k + k1))));
+	const float n2 = corner(x0 - i2 + 2.f * G3, y0 - j2 + 2.f * G3, z0 - k2 + 2.f * G3, hash(i + i2 + hash(j + j2 + hash(k + k2))));
+	const float n3 = corner(x0 - 1.f + 3.f * G3, y0 - 1.f + 3.f * G3, z0 - 1.f + 3.f * G3, hash(i + 1 + hash(j + 1 + hash(k + 1))));
+
+	return 32.f * (n0 + n1 + n2 + n3);
+}
+
+ns::HeightType ns::Sphere::ridgedSimplexNoise(const glm::vec3& location)
+{
+	return 2.0_ht * (std::abs(0.5_ht - simplexNoise(location)));
+}
+
+
+//BATCHED SIMPLEX NOISE 3D
+//
+//the same algorithm as simplexNoise() but written with lanes wrappers so each call compute several values
+
+namespace {
+#ifdef NS_SIMD_LANES
+	using ns::simd::Lanes;
+
+	//same behavior as floorToInt()
+	inline Lanes::I floorLanes(Lanes::F x)
+	{
+		const Lanes::I i = Lanes::truncate(x);
+		return Lanes::sub(i, Lanes::maskToOne(Lanes::greater(Lanes::toFloat(i), x)));
+	}
+
+	inline Lanes::I hashLanes(Lanes::I i)
+	{
+		return Lanes::gather(perm.data(), Lanes::bitAnd(i, Lanes::set(255)));
+	}
+
+	inline Lanes::F cornerLanes(Lanes::F x, Lanes::F y, Lanes::F z, Lanes::I hash)
+	{
+		Lanes::F t = Lanes::sub(Lanes::sub(Lanes::sub(Lanes::set(.6f), Lanes::mul(x, x)), Lanes::mul(y, y)), Lanes::mul(z, z));
+		t = Lanes::max(t, Lanes::set(0.f));
+		t = Lanes::mul(t, t);
+
+		const Lanes::I h = Lanes::bitAnd(hash, Lanes::set(15));
+		const Lanes::F dot = Lanes::add(Lanes::add(
+			Lanes::mul(Lanes::gather(gradients.x.data(), h), x),
+			Lanes::mul(Lanes::gather(gradients.y.data(), h), y)),
+			Lanes::mul(Lanes::gather(gradients.z.data(), h), z));
+
+		return Lanes::mul(Lanes::mul(t, t), dot);
+	}
+
+	//hash of the corner (i + di, j + dj, k + dk)
+	inline Lanes::I cornerHash(Lanes::I i, Lanes::I j, Lanes::I k, Lanes::I di, Lanes::I dj, Lanes::I dk)
+	{
+		return hashLanes(Lanes::add(Lanes::add(i, di), hashLanes(Lanes::add(Lanes::add(j, dj), hashLanes(Lanes::add(k, dk))))));
+	}
+
+	template<bool ridged>
+	inline Lanes::F simplexLanes(Lanes::F inX, Lanes::F inY, Lanes::F inZ)
+	{
+		const Lanes::F s = Lanes::mul(Lanes::add(Lanes::add(inX, inY), inZ), Lanes::set(F3));
+		const Lanes::I i = floorLanes(Lanes::add(inX, s));
+		const Lanes::I j = floorLanes(Lanes::add(inY, s));
+		const Lanes::I k = floorLanes(Lanes::add(inZ, s));
+
+		const Lanes::F t = Lanes::mul(Lanes::toFloat(Lanes::add(Lanes::add(i, j), k)), Lanes::set(G3));
+		const Lanes::F x0 = Lanes::sub(inX, Lanes::sub(Lanes::toFloat(i), t));
+		const Lanes::F y0 = Lanes::sub(inY, Lanes::sub(Lanes::toFloat(j), t));
+		const Lanes::F z0 = Lanes::sub(inZ, Lanes::sub(Lanes::toFloat(k), t));
+
+		//the branches of simplexNoise() written with the ranks of the coordinates:
+		//the second corner moves along the biggest coordinate and the third one along the two biggest
+		const Lanes::M xy = Lanes::greaterEqual(x0, y0);
+		const Lanes::M xz = Lanes::greaterEqual(x0, z0);
+		const Lanes::M yx = Lanes::greater(y0, x0);
+		const Lanes::M yz = Lanes::greaterEqual(y0, z0);
+		const Lanes::M zx = Lanes::greater(z0, x0);
+		const Lanes::M zy = Lanes::greater(z0, y0);
+
+		const Lanes::I i1 = Lanes::maskToOne(Lanes::maskAnd(xy, xz));
+		const Lanes::I j1 = Lanes::maskToOne(Lanes::maskAnd(yx, yz));
+		const Lanes::I k1 = Lanes::maskToOne(Lanes::maskAnd(zx, zy));
+		const Lanes::I i2 = Lanes::maskToOne(Lanes::maskOr(xy, xz));
+		const Lanes::I j2 = Lanes::maskToOne(Lanes::maskOr(yx, yz));
+		const Lanes::I k2 = Lanes::maskToOne(Lanes::maskOr(zx, zy));
+
+		const Lanes::F g1 = Lanes::set(G3);
+		const Lanes::F g2 = Lanes::set(2.f * G3);
+		const Lanes::F g3 = Lanes::set(3.f * G3 - 1.f);
+		const Lanes::I zero = Lanes::set(0);
+		const Lanes::I one = Lanes::set(1);
+
+		const Lanes::F n0 = cornerLanes(x0, y0, z0, cornerHash(i, j, k, zero, zero, zero));
+		const Lanes::F n1 = cornerLanes(
+			Lanes::add(Lanes::sub(x0, Lanes::toFloat(i1)), g1),
+			Lanes::add(Lanes::sub(y0, Lanes::toFloat(j1)), g1),
+			Lanes::add(Lanes::sub(z0, Lanes::toFloat(k1)), g1),
+			cornerHash(i, j, k, i1, j1, k1));
+		const Lanes::F n2 = cornerLanes(
+			Lanes::add(Lanes::sub(x0, Lanes::toFloat(i2)), g2),
+			Lanes::add(Lanes::sub(y0, Lanes::toFloat(j2)), g2),
+			Lanes::add(Lanes::sub(z0, Lanes::toFloat(k2)), g2),
+			cornerHash(i, j, k, i2, j2, k2));
+		const Lanes::F n3 = cornerLanes(Lanes::add(x0, g3), Lanes::add(y0, g3), Lanes::add(z0, g3), cornerHash(i, j, k, one, one, one));
+
+		const Lanes::F n = Lanes::mul(Lanes::set(32.f), Lanes::add(Lanes::add(n0, n1), Lanes::add(n2, n3)));
+
+		if constexpr (ridged)
+			return Lanes::mul(Lanes::set(2.f), Lanes::abs(Lanes::sub(Lanes::set(.5f), n)));
+		else
+			return n;
+	}
+#endif
+
+	template<bool ridged>
+	void simplexBatch(const ns::LengthType* xs, const ns::LengthType* ys, const ns::LengthType* zs, size_t count, ns::HeightType* output)
+	{
+		size_t i = 0;
+
+#ifdef NS_SIMD_LANES
+		for (; i + Lanes::width <= count; i += Lanes::width)
+		{
+			Lanes::store(output + i, simplexLanes<ridged>(Lanes::load(xs + i), Lanes::load(ys + i), Lanes::load(zs + i)));
+		}
+#endif
+
+		//remaining values that do not fill a whole register
+		for (; i < count; i++)
+		{
+			if constexpr (ridged)
+				output[i] = ns::Sphere::ridgedSimplexNoise(glm::vec3(xs[i], ys[i], zs[i]));
+			else
+				output[i] = ns::Sphere::simplexNoise(glm::vec3(xs[i], ys[i], zs[i]));
+		}
+	}
+}
+
+void ns::Sphere::simplexNoise(const LengthType* xs, const LengthType* ys, const LengthType* zs, size_t count, HeightType* output)
+{
+	simplexBatch<false>(xs, ys, zs, count, output);
+}
+
+void ns::Sphere::ridgedSimplexNoise(const LengthType* xs, const LengthType* ys, const LengthType* zs, size_t count, HeightType* output)
+{
+	simplexBatch<true>(xs, ys, zs, count, output);
+}
@@ -0,0 +1,59 @@
+#pragma once
+#include <configNoisy.hpp>
+
+//stl
+#include <vector>
+
+namespace ns::Sphere {
+	/**
+	 * @brief compute the elevation of the terrain of a planet for each direction from its center,
+	 * it is the sphere version of Plane::HeightMapGenerator: a sum of octaves of 3d simplex noise sampled on the unit sphere
+	 */
+	class PlanetGenerator
+	{
+	public:
+		struct Octave {
+			LengthType frequency;
+			LengthType amplitude;
+			LengthType offset;
+			bool ridged;
+		};
+
+		struct Settings {
+			std::vector<Octave> octaves;
+			double exponent;
+			HeightType elevation;		//maximum elevation of the terrain relative to the radius of the planet
+			uint16_t chunkResolution;	//number of squares on each side of a chunk mesh
+		};
+
+		PlanetGenerator(const Settings& settings);
+		/**
+		 * @brief settings of the terrain of the first planets (two octaves and an elevation of 3% of the radius)
+		 * \return
+		 */
+		static Settings defaultSettings();
+		const Settings& settings() const;
+		//elevation of a direction relative to the radius, direction must be normalized
+		HeightType operator()(const glm::vec3& direction) const;
+		//compute count elevations, output must be able to store count heights
+		void operator()(const glm::vec3* directions, size_t count, HeightType* output) const;
+
+		//maximum difference between the batched function and the scalar function (fused multiply-add contraction can change the last bits),
+		//the debug builds check the first and the last sample of each batch
+		static constexpr HeightType batchTolerance = 1e-4_ht;
+
+	protected:
+		const Settings settings_;
+		HeightType inversedAmplitudeRect_;
+
+	protected:
+		//apply the exponent and the elevation to a normalized sum of octaves
+		HeightType shape(HeightType height) const;
+	};
+
+	HeightType simplexNoise(const glm::vec3& location);
+	HeightType ridgedSimplexNoise(const glm::vec3& location);
+	//batched versions of the noises, compute count values using SIMD lanes when they are available
+	void simplexNoise(const LengthType* xs, const LengthType* ys, const LengthType* zs, size_t count, HeightType* output);
+	void ridgedSimplexNoise(const LengthType* xs, const LengthType* ys, const LengthType* zs, size_t count, HeightType* output);
+}
@@ -1,6 +1,9 @@
 #pragma once
 #include <configNoisy.hpp>
 
+//stl
+#include <cmath>
+
 #define NUMBER_OF_FACES_IN_A_CUBE 6U
 #define NULL_FACE_INDEX 7U
 
@@ -14,4 +17,19 @@ namespace ns::Sphere{
 		glm::vec3 center;
 		float radius;
 	};
+
+	/**
+	 * @brief map a point of the cube [-1, 1]^3 on the unit sphere (spherified cube), the cells of a face keep almost the same area on the sphere
+	 * \param p point on a face of the cube
+	 * \return the normalized direction
+	 */
+	inline glm::vec3 cubeToSphere(const glm::vec3& p)
+	{
+		const glm::vec3 p2 = p * p;
+		return glm::vec3(
+			p.x * std::sqrt(1.0f - 0.5f * (p2.y + p2.z) + p2.y * p2.z / 3.0f),
+			p.y * std::sqrt(1.0f - 0.5f * (p2.z + p2.x) + p2.z * p2.x / 3.0f),
+			p.z * std::sqrt(1.0f - 0.5f * (p2.x + p2.y) + p2.x * p2.y / 3.0f)
+		);
+	}
 }
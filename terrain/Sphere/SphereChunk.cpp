@@ -2,104 +2,142 @@
 #include <Utils/DebugLayer.h>
 #include <Utils/utils.h>
 
-ns::Sphere::SphereChunk::SphereChunk(const std::array<glm::vec3, 4>& chunkLocation, float sphereRadius, uint16_t resolution) :
+namespace {
+	/**
+	 * @brief move a point of the plane of a cube face that is past the edges of the face onto the next faces,
+	 * at the same distance from the edge, so it lands on the grid of the neighbour chunks
+	 * \param p point on the plane of the face
+	 * \param axis axis of the normal of the face
+	 * \param side sign of the face on its axis
+	 */
+	glm::vec3 foldOnCube(glm::vec3 p, int axis, float side)
+	{
+		for (int a = 0; a < 3; a++)
+		{
+			if (a == axis or std::abs(p[a]) <= 1.f) continue;
+
+			const float past = std::abs(p[a]) - 1.f;
+			p[a] = std::copysign(1.f, p[a]);
+			p[axis] -= side * past;
+		}
+		return p;
+	}
+}
+
+ns::Sphere::SphereChunk::SphereChunk(const Cell& cell, float sphereRadius, const PlanetGenerator& generator) :
 	sphereRadius_(sphereRadius),
-	resolution_(resolution)
+	resolution_(generator.settings().chunkResolution)
 {
-	using namespace glm;
-	BiArray<glm::vec3> grid(glm::ivec2(resolution_ + 1));
-
-	auto location = chunkLocation;
-	//normalize inputs (should be removable)
-	for (size_t i = 0; i < chunkLocation.size(); i++)
-		location[i] = normalize(chunkLocation[i]);
+	mesh_ = std::make_unique<Mesh>(generateVertices(cell, sphereRadius, generator), generateIndices(resolution_), Material(glm::vec3(.05), .6, .9));
+}
 
-	//calculate the rotation from location[0] to location[1]
-	vec3 rotAxis = cross(location[0], location[1]);
-	float angleStep = -acos(dot(location[0], location[1])) / resolution_;
+ns::Sphere::SphereChunk::SphereChunk(const std::vector<Vertex>& vertices, const std::shared_ptr<const IndexBuffer>& indices, float sphereRadius, uint16_t resolution) :
+	sphereRadius_(sphereRadius),
+	resolution_(resolution)
+{
+	mesh_ = std::make_unique<Mesh>(vertices, indices, Material(glm::vec3(.05), .6, .9));
+}
 
-	for (uint16_t i = 1; i < resolution_; i++)
+std::vector<ns::Vertex> ns::Sphere::SphereChunk::generateVertices(const Cell& cell, float sphereRadius, const PlanetGenerator& generator)
+{
+	using namespace glm;
+	const uint16_t resolution = generator.settings().chunkResolution;
+	const size_t width = (size_t)resolution + 1;
+
+	//the grid is surrounded by one ring of samples of the neighbour chunks, so the normals of the border
+	//are computed with the same samples as the ones of the neighbours (no seam in the lighting)
+	const size_t paddedWidth = width + 2;
+	BiArray<glm::vec3> padded(glm::ivec2(static_cast<int>(paddedWidth)));
+
+	//a point is at column / (resolution * 2^level) of the face: a point shared with a node of the next level has both integers doubled,
+	//and the scaling by a power of two doesn't change the rounding, so the two nodes compute the same coordinates
+	const double divisions = static_cast<double>((int64_t)resolution << cell.level);
+	const int64_t firstColumn = (int64_t)cell.position.x * resolution - 1;
+	const int64_t firstRow = (int64_t)cell.position.y * resolution - 1;
+
+	//the ring is past the edges of the face for the chunks on a border of the face, it is folded on the next face
+	const vec3 faceNormal = abs(cross(cell.faceRight, cell.faceUp));
+	const int axis = (faceNormal.x > faceNormal.y and faceNormal.x > faceNormal.z) ? 0 : (faceNormal.y > faceNormal.z) ? 1 : 2;
+	const float side = std::copysign(1.f, cell.faceOrigin[axis]);
+
+	for (int j = 0; j < (int)paddedWidth; j++)
 	{
-		grid.value(i, 0) = vec4(location[0], 1.f) * rotate(angleStep * i, rotAxis);
+		const vec3 row = cell.faceOrigin + cell.faceUp * static_cast<float>((firstRow + j) / divisions);
+		for (int i = 0; i < (int)paddedWidth; i++)
+			padded.value(i, j) = cubeToSphere(foldOnCube(row + cell.faceRight * static_cast<float>((firstColumn + i) / divisions), axis, side));
 	}
-	grid.value(0, 0) = location[0];
-	grid.value(resolution_, 0) = location[1];
 
-	//calculate the rotation from location[2] to location[3]
-	rotAxis = cross(location[2], location[3]);
-	angleStep = -acos(dot(location[2], location[3])) / resolution_;
+	//heightmap generation, all the directions of the grid are given at once to the batched noise
+	thread_local std::vector<HeightType> heights;
+	heights.resize(padded.size());
+	generator(padded.data(), padded.size(), heights.data());
 
-	for (uint16_t i = 1; i < resolution_; i++)
-	{
-		grid.value(i, resolution_) = vec4(location[2], 1.f) * rotate(angleStep * i, rotAxis);
-	}
-	grid.value(0, resolution_) = location[2];
-	grid.value(resolution_, resolution_) = location[3];
+	for (size_t i = 0; i < padded.size(); i++)
+		padded[i] *= sphereRadius * (1.f + heights[i]);
 
-	for (uint16_t i = 0; i < resolution_ + 1; i++)
+	//smooth normals with central differences, like the plane terrain : they don't depend on the diagonals of the triangles,
+	//which are not in the same direction on the two sides of an edge of the cube
+	std::vector<Vertex> vertices(width * width);
+	for (size_t j = 0; j < width; j++)
 	{
-		const auto& a = grid.value(i, 0);
-		const auto& b = grid.value(i, resolution_);
-
-		//calculate the rotation from a to b
-		rotAxis = cross(a, b);
-		angleStep = -acos(dot(a, b)) / resolution_;
-		
-		for (uint16_t j = 1; j < resolution_; j++)
+		for (size_t i = 0; i < width; i++)
 		{
-			grid.value(i, j) = vec4(a, 1.f) * rotate(angleStep * j, rotAxis);
-		}
-	}
+			const vec3 alongUp = padded[TWO_DIM(i + 1, j + 2, paddedWidth)] - padded[TWO_DIM(i + 1, j, paddedWidth)];
+			const vec3 alongRight = padded[TWO_DIM(i + 2, j + 1, paddedWidth)] - padded[TWO_DIM(i, j + 1, paddedWidth)];
 
-	//heightmap generation
-	for (uint16_t i = 0; i < resolution_ + 1; i++)
-	{
-		for (uint16_t j = 0; j < resolution_ + 1; j++)
-		{
-			auto& v = grid.value(i, j);
-			v *= sphereRadius_ + noise(v * 1.1f) * .02f * sphereRadius_ + noise(v * 10.f) * .01f * sphereRadius_;
+			Vertex& vertex = vertices[TWO_DIM(i, j, width)];
+			vertex.position = padded[TWO_DIM(i + 1, j + 1, paddedWidth)];
+			vertex.normal = normalize(cross(alongUp, alongRight));
 		}
 	}
 
-	// mesh generation
-	std::vector<Vertex> vertices((size_t)resolution_ * resolution_ * 4U);
-	//std::vector<unsigned> indices((size_t)resolution_ * resolution_ * 6U);
-	std::vector<unsigned> indices;
+	return vertices;
+}
+
+std::vector<unsigned> ns::Sphere::SphereChunk::generateIndices(uint16_t resolution, uint8_t coarseSides)
+{
+#	ifndef NDEBUG
+	_STL_ASSERT(coarseSides == 0 or resolution % 2 == 0, "a chunk can only be stitched with an even resolution");
+#	endif // !NDEBUG
 
-	size_t verticesCount = 0U, indicesCount = 0U;
-	for (uint16_t i = 0; i < resolution_; i++)
+	const unsigned width = (unsigned)resolution + 1;
+	std::vector<unsigned> indices;
+	indices.reserve((size_t)resolution * resolution * 6U);
+
+	//on a stitched side the odd vertices are merged with the previous ones, so the border is made of the edges of the coarser neighbour
+	auto vertex = [&](unsigned i, unsigned j) {
+		if (((coarseSides & bottom) and j == 0) or ((coarseSides & top) and j == resolution))
+			i -= i % 2;
+		if (((coarseSides & left) and i == 0) or ((coarseSides & right) and i == resolution))
+			j -= j % 2;
+		return (unsigned)TWO_DIM(i, j, width);
+	};
+
+	//the triangles that lose an edge are removed
+	auto addTriangle = [&](unsigned a, unsigned b, unsigned c) {
+		if (a != b and b != c and c != a)
+			indices.insert(indices.end(), { a, b, c });
+	};
+
+	for (unsigned j = 0; j < resolution; j++)
 	{
-		for (uint16_t j = 0; j < resolution_; j++)
+		for (unsigned i = 0; i < resolution; i++)
 		{
-			vec3 a = grid.value(i + 0, j + 0);
-			vec3 b = grid.value(i + 0, j + 1);
-			vec3 c = grid.value(i + 1, j + 0);
-			vec3 d = grid.value(i + 1, j + 1);
-			vec3 n1 = normalize(genNormal(a, b, c));
-			vec3 n2 = normalize(genNormal(c, b, d));
-
-			vertices.emplace(vertices.begin() + verticesCount + 0, a, n1);
-			vertices.emplace(vertices.begin() + verticesCount + 1, b, n1);
-			vertices.emplace(vertices.begin() + verticesCount + 2, c, n1);
-			vertices.emplace(vertices.begin() + verticesCount + 3, c, n2);
-			vertices.emplace(vertices.begin() + verticesCount + 4, b, n2);
-			vertices.emplace(vertices.begin() + verticesCount + 5, d, n2);
-
-			//indices.emplace(indices.begin() + indicesCount + 0, verticesCount + 0);
-			//indices.emplace(indices.begin() + indicesCount + 1, verticesCount + 1);
-			//indices.emplace(indices.begin() + indicesCount + 2, verticesCount + 2);
-			//indices.emplace(indices.begin() + indicesCount + 3, verticesCount + 1);
-			//indices.emplace(indices.begin() + indicesCount + 4, verticesCount + 3);
-			//indices.emplace(indices.begin() + indicesCount + 5, verticesCount + 2);
-
-			//indicesCount += 6;
-			verticesCount += 6;
+			const unsigned a = vertex(i + 0, j + 0);
+			const unsigned b = vertex(i + 0, j + 1);
+			const unsigned c = vertex(i + 1, j + 0);
+			const unsigned d = vertex(i + 1, j + 1);
+
+			addTriangle(a, b, c);
+			addTriangle(c, b, d);
 		}
 	}
+	return indices;
+}
 
-	MeshConfigInfo info;
-	info.indexedVertices = false;
-	mesh_ = std::make_unique<Mesh>(vertices, indices, Material(vec3(.05), .6, .9), info);
+void ns::Sphere::SphereChunk::setIndices(const std::shared_ptr<const IndexBuffer>& indices)
+{
+	mesh_->setIndices(indices);
 }
 
 void ns::Sphere::SphereChunk::draw(const ns::Shader& shader) const
@@ -1,6 +1,7 @@
 #pragma once
 #include <array>
 #include <terrain/Sphere/Sphere.h>
+#include <terrain/Sphere/PlanetGenerator.h>
 #include <Utils/BiArray.h>
 #include <Rendering/Drawable.h>
 
@@ -9,13 +10,63 @@ namespace ns::Sphere
 	class SphereChunk : public Drawable
 	{
 	public:
+		//sides of a chunk, used as bits to describe the sides whose neighbour is coarser
+		enum Side : uint8_t {
+			bottom = 1 << 0,	//first row of the grid
+			right = 1 << 1,		//last column of the grid
+			top = 1 << 2,		//last row of the grid
+			left = 1 << 3		//first column of the grid
+		};
+
+		//square of the grid of a level of detail on a face of the cube
+		struct Cell {
+			glm::vec3 faceOrigin{};		//corner (0, 0) of the face on the cube [-1, 1]^3
+			glm::vec3 faceRight{};		//side of the face along the columns of the grid
+			glm::vec3 faceUp{};			//side of the face along the rows of the grid
+			glm::u16vec2 position{};	//column and row of the square in the grid of its level
+			uint8_t level = 0;			//the face is divided in 2^level * 2^level squares
+		};
+
+		/**
+		 * @brief create one chunk of a sphere based on a square on a face of the cube that is mapped on the sphere
+		 * \param cell square of the chunk on the cube
+		 * \param sphereRadius
+		 * \param generator elevation of the terrain, its settings give the resolution of the chunk
+		 */
+		SphereChunk(const Cell& cell, float sphereRadius, const PlanetGenerator& generator);
 		/**
-		 * @brief create one chunk of a sphere based on a square that is the location of the sphere
-		 * \param chunkLocation a square that locate the chunk on a sphere
+		 * @brief create the mesh of a chunk from the vertices computed by generateVertices(), it must be called by the opengl thread
+		 * \param vertices
+		 * \param indices index buffer of generateIndices() with the same resolution, shared by all the chunks
 		 * \param sphereRadius
 		 * \param resolution
 		 */
-		SphereChunk(const std::array<glm::vec3, 4>& chunkLocation, float sphereRadius, uint16_t resolution);
+		SphereChunk(const std::vector<Vertex>& vertices, const std::shared_ptr<const IndexBuffer>& indices, float sphereRadius, uint16_t resolution);
+		/**
+		 * @brief compute the vertices of a chunk without creating its mesh, so it can be called by any thread
+		 * each point of the (resolution + 1)^2 grid is a single vertex with a smooth normal,
+		 * the points are computed from their integer coordinates on the grid of the whole face at the deepest of the two levels,
+		 * so the border vertices of a chunk are bit-identical to the even border vertices of its finer neighbours,
+		 * and the normals use one more ring of samples around the grid so two chunks of the same size have the same normals on their border
+		 * \param cell square of the chunk on the cube
+		 * \param sphereRadius
+		 * \param generator elevation of the terrain, its settings give the resolution of the chunk
+		 * \return the vertices of the grid, row by row
+		 */
+		static std::vector<Vertex> generateVertices(const Cell& cell, float sphereRadius, const PlanetGenerator& generator);
+		/**
+		 * @brief compute the triangles of a grid of vertices generated by generateVertices(), they are the same for all the chunks
+		 * on the stitched sides one vertex out of two is skipped, so the border matches the one of a neighbour twice bigger
+		 * \param resolution must be even when sides are stitched
+		 * \param coarseSides Side bits of the sides to stitch
+		 * \return the indices of the triangles
+		 */
+		static std::vector<unsigned> generateIndices(uint16_t resolution, uint8_t coarseSides = 0);
+		/**
+		 * @brief replace the triangles of the chunk, the index buffer must come from generateIndices() with the same resolution
+		 * \param indices
+		 */
+		void setIndices(const std::shared_ptr<const IndexBuffer>& indices);
 
 		virtual void draw(const ns::Shader& shader) const override;
 
@@ -1,18 +1,75 @@
 #include "SphereContainer.h"
+#include <Utils/JobSystem.h>
 
 //stl
 #include <future>
 #include <mutex>
+#include <chrono>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+	//number of rows of a face computed by one job of the grid generation
+	constexpr uint32_t rowsPerJob = 16;
+	//the children of a node are kept until the camera is this times further than the split distance, so they aren't reloaded when it oscillates around
+	constexpr float mergeDistanceFactor = 1.25f;
+	//deepest level of the quadtrees, the cells of a level are addressed with the 16 bits coordinates of an index
+	constexpr uint8_t maximumLevel = 15;
+
+	//corner of the grid of each face of the cube and the directions of its rows and columns
+	const glm::vec3 faceOrigins[NUMBER_OF_FACES_IN_A_CUBE]
+	{
+		glm::vec3(-1.0, -1.0, -1.0),
+		glm::vec3(1.0, -1.0, -1.0),
+		glm::vec3(1.0, -1.0, 1.0),
+		glm::vec3(-1.0, -1.0, 1.0),
+		glm::vec3(-1.0, 1.0, -1.0),
+		glm::vec3(-1.0, -1.0, 1.0)
+	};
+	const glm::vec3 faceRights[NUMBER_OF_FACES_IN_A_CUBE]
+	{
+		glm::vec3(2.0, 0.0, 0.0),
+		glm::vec3(0.0, 0.0, 2.0),
+		glm::vec3(-2.0, 0.0, 0.0),
+		glm::vec3(0.0, 0.0, -2.0),
+		glm::vec3(2.0, 0.0, 0.0),
+		glm::vec3(2.0, 0.0, 0.0)
+	};
+	const glm::vec3 faceUps[NUMBER_OF_FACES_IN_A_CUBE]
+	{
+		glm::vec3(0.0, 2.0, 0.0),
+		glm::vec3(0.0, 2.0, 0.0),
+		glm::vec3(0.0, 2.0, 0.0),
+		glm::vec3(0.0, 2.0, 0.0),
+		glm::vec3(0.0, 0.0, 2.0),
+		glm::vec3(0.0, 0.0, -2.0)
+	};
+
+	//sides of a node in the order of the bits of SphereChunk::Side
+	const glm::ivec2 sideOffsets[4]
+	{
+		glm::ivec2(0, -1),
+		glm::ivec2(1, 0),
+		glm::ivec2(0, 1),
+		glm::ivec2(-1, 0)
+	};
+
+	//the stitching of the chunks removes one vertex out of two on their borders
+	ns::Sphere::PlanetGenerator::Settings evenChunkResolution(ns::Sphere::PlanetGenerator::Settings settings)
+	{
+		settings.chunkResolution += settings.chunkResolution % 2;
+		return settings;
+	}
+}
 
 const ns::Sphere::SphereContainer::Index ns::Sphere::SphereContainer::Index::null(NULL_FACE_INDEX);
-std::array<std::vector<glm::ivec2>, ns::maximunRenderDistance> ns::Sphere::SphereContainer::loadingOrder = ns::Sphere::SphereContainer::getOrder();
 
-ns::Sphere::SphereContainer::SphereContainer(uint32_t resolution, float sphereRadius)
+ns::Sphere::SphereContainer::SphereContainer(uint32_t resolution, float sphereRadius, const PlanetGenerator::Settings& generation, bool async)
 	:
 	resolution_(resolution + resolution % 2),//resolution is forced to be an even number
 	resolutionPlusOne_(resolution_ + 1),
 	radius_(sphereRadius),
-	//sphereThread_(&genSphereVertices, this),
+	generator_(evenChunkResolution(generation)),
 	terrain_({ 
 		BiArray<SphereContainer::Chunk>(glm::ivec2(resolution_)),
 		BiArray<SphereContainer::Chunk>(glm::ivec2(resolution_)),
@@ -27,19 +84,50 @@ ns::Sphere::SphereContainer::SphereContainer(uint32_t resolution, float sphereRa
 		BiArray<glm::vec3>(glm::ivec2(resolutionPlusOne_)),
 		BiArray<glm::vec3>(glm::ivec2(resolutionPlusOne_)),
 		BiArray<glm::vec3>(glm::ivec2(resolutionPlusOne_))
-	})
+	}),
+	sphereProgression_(0),
+	ready_(false),
+	maxLevel_(std::min(static_cast<uint8_t>(std::ceil(std::log2(static_cast<double>(resolution_)))), maximumLevel)),
+	maxLoadingJobs_(2 * JobSystem::get().numberOfThreads()),
+	uploadBudget_(2.f)
+{
+	setLodSettings(glm::pi<float>() * .4f, 1080.f, 8.f);
+
+	for (uint8_t face = 0; face < NUMBER_OF_FACES_IN_A_CUBE; face++)
+		initNode(roots_[face], Index(face, 0, 0), 0);
+
+	if (async)
+		sphereThread_ = std::thread(&genSphereVertices, this);
+	else
+		genSphereVertices(this);
+}
+
+ns::Sphere::SphereContainer::~SphereContainer()
 {
-	genSphereVertices(this);
-	//sphereThread_.join();
+	if (sphereThread_.joinable())
+		sphereThread_.join();
+
+	//the jobs push their results in the container
+	JobSystem::get().wait(loadingJobs_);
 }
 
 double ns::Sphere::SphereContainer::sphereProgressionPercentage() const
 {
-	return ((double)sphereProgression_ / ((double)resolutionPlusOne_ * (double)resolutionPlusOne_ * (double)NUMBER_OF_FACES_IN_A_CUBE)) * 100.0;
+	//each vertex and each chunk of the grid is a step of the generation
+	const double vertices = (double)resolutionPlusOne_ * (double)resolutionPlusOne_;
+	const double chunks = (double)resolution_ * (double)resolution_;
+	return ((double)sphereProgression_ / ((vertices + chunks) * (double)NUMBER_OF_FACES_IN_A_CUBE)) * 100.0;
+}
+
+bool ns::Sphere::SphereContainer::isReady() const
+{
+	return ready_;
 }
 
 std::shared_ptr<ns::Mesh> ns::Sphere::SphereContainer::getDebugSphere() const
 {
+	if (!isReady()) return std::shared_ptr<Mesh>();
+
 	MeshConfigInfo info_;
 	info_.indexedVertices = false;
 	info_.primitive = GL_LINES;
@@ -70,9 +158,15 @@ std::shared_ptr<ns::Mesh> ns::Sphere::SphereContainer::getDebugSphere() const
 
 std::shared_ptr<ns::Sphere::SphereChunk> ns::Sphere::SphereContainer::findChunk(const glm::vec3& normalizedVector)
 {
+	if (!isReady()) return std::shared_ptr<SphereChunk>();
+
 	const auto index = find(normalizedVector);
 	if (index.isNull()) return std::shared_ptr<SphereChunk>();
-	return chunk(index).mesh;
+
+	//cell of the deepest level that contains the chunk of the grid
+	const uint64_t cells = 1ULL << maxLevel_;
+	const Index cell(index.face, static_cast<uint16_t>(index.i * cells / resolution_), static_cast<uint16_t>(index.j * cells / resolution_));
+	return visibleNode(cell, maxLevel_).mesh;
 }
 
 float ns::Sphere::SphereContainer::radius() const
@@ -80,44 +174,67 @@ float ns::Sphere::SphereContainer::radius() const
 	return radius_;
 }
 
-void ns::Sphere::SphereContainer::update(const glm::vec3& direction)
+const ns::Sphere::PlanetGenerator& ns::Sphere::SphereContainer::generator() const
 {
-	const Index centralChunk = find(direction);
-	if (!centralChunk.isNull())
-		centralChunk_ = centralChunk;
+	return generator_;
+}
 
-	bool loaded = false;
+void ns::Sphere::SphereContainer::update(const glm::vec3& cameraPosition)
+{
+	//the quadtrees only need the mapping of the cube so they don't wait for the grid
+	uploadChunks(cameraPosition);
+
+	visibleNodes_.clear();
+	requestedNodes_.clear();
+	for (LodNode& root : roots_)
+		selectNodes(root, cameraPosition);
+
+	//a merge can make a region coarser than the children of its neighbours, so the restriction is repeated until nothing changes
+	bool merged = true;
+	while (merged) {
+		merged = false;
+		for (LodNode& root : roots_)
+			merged |= restrictNode(root);
+	}
 
-	size_t renderd = 10;
-	
-	for (size_t d = 0; d < renderd and !loaded; d++)
-	{
-		for (size_t i = 0; i < loadingOrder[d].size(); i++)
-		{
-			Index index = centralChunk_;
-			index.add(loadingOrder[d][i], resolution_, 0);
+	for (LodNode& root : roots_)
+		collectNodes(root);
 
-			if (loadChunk(index)) { loaded = true; break; }
-		}
-	}
+	stitchNodes();
+	requestNodes();
+}
 
-	if(!(rand() % 20))
-		for (size_t d = renderd; d < renderd * 4; d++)
-		{
-			for (size_t i = 0; i < loadingOrder[d].size(); i++)
-			{
-				Index index = centralChunk_;
-				index.add(loadingOrder[d][i], resolution_, 0);
-		
-				 (unloadChunk(index));
-			}
-		}
+void ns::Sphere::SphereContainer::setLodSettings(float fov, float screenHeight, float maximumError)
+{
+	projectionScale_ = screenHeight / (2.f * std::tan(.5f * fov));
+	maximumError_ = std::max(maximumError, 1e-3f);
+}
+
+void ns::Sphere::SphereContainer::setUploadBudget(float milliseconds)
+{
+	uploadBudget_ = milliseconds;
+}
+
+float ns::Sphere::SphereContainer::uploadBudget() const
+{
+	return uploadBudget_;
+}
+
+void ns::Sphere::SphereContainer::clear()
+{
+	//the jobs find the nodes with their index so the results of the running ones are only discarded
+	for (LodNode& root : roots_) {
+		root.mesh.reset();
+		root.children.reset();
+		root.split = false;
+	}
+	visibleNodes_.clear();
 }
 
 void ns::Sphere::SphereContainer::draw(const ns::Shader& shader) const
 {
-	for (const Chunk* chunk : loadedChunks_) {
-		chunk->mesh->draw(shader);
+	for (const LodNode* node : visibleNodes_) {
+		node->mesh->draw(shader);
 	}
 }
 
@@ -131,23 +248,21 @@ bool ns::Sphere::SphereContainer::checkCoordIsInLimit(const glm::vec3& position,
 
 void ns::Sphere::SphereContainer::fillChunkLimits(ChunkLimits& limit, const ChunkCoords& chunk)
 {
-	//put each position component in an array
-	std::array<float, 4> Xs{ vertex(chunk.a).x , vertex(chunk.b).x , vertex(chunk.c).x , vertex(chunk.d).x };
-	std::array<float, 4> Ys{ vertex(chunk.a).y , vertex(chunk.b).y , vertex(chunk.c).y , vertex(chunk.d).y };
-	std::array<float, 4> Zs{ vertex(chunk.a).z , vertex(chunk.b).z , vertex(chunk.c).z , vertex(chunk.d).z };
-
-	//sort those arrays
-	std::sort(Xs.begin(), Xs.end());
-	std::sort(Ys.begin(), Ys.end());
-	std::sort(Zs.begin(), Zs.end());
+	const glm::vec3& a = vertex(chunk.a);
+	const glm::vec3& b = vertex(chunk.b);
+	const glm::vec3& c = vertex(chunk.c);
+	const glm::vec3& d = vertex(chunk.d);
 
 	//store the maximun and minimun components
-	limit.maxX = Xs[3];
-	limit.minX = Xs[0];
-	limit.maxY = Ys[3];
-	limit.minY = Ys[0];
-	limit.maxZ = Zs[3];
-	limit.minZ = Zs[0];
+	const glm::vec3 minimum = glm::min(glm::min(a, b), glm::min(c, d));
+	const glm::vec3 maximum = glm::max(glm::max(a, b), glm::max(c, d));
+
+	limit.maxX = maximum.x;
+	limit.minX = minimum.x;
+	limit.maxY = maximum.y;
+	limit.minY = minimum.y;
+	limit.maxZ = maximum.z;
+	limit.minZ = minimum.z;
 }
 
 void ns::Sphere::SphereContainer::fillChunkSubRegions(ChunksRegion& reg, uint8_t face)
@@ -236,11 +351,6 @@ ns::Sphere::SphereContainer::Chunk& ns::Sphere::SphereContainer::chunk(const ns:
 	return terrain_[index.face].value(index.i, index.j);
 }
 
-bool ns::Sphere::SphereContainer::isLoaded(const Index& index) const
-{
-	return chunk(index).mesh.operator bool();
-}
-
 ns::Sphere::SphereContainer::Index ns::Sphere::SphereContainer::find(const glm::vec3& position) const
 {
 #	ifndef NDEBUG
@@ -248,6 +358,35 @@ ns::Sphere::SphereContainer::Index ns::Sphere::SphereContainer::find(const glm::
 	_STL_ASSERT(std::abs(1.f - l) < .1f, ("the vec3 inserted into SphereContainer::find(vec3) was not normalized ! l " + std::to_string(l)).c_str());
 #	endif // !NDEBUG
 
+	const glm::vec3 cube = sphereToCube(position);
+
+	//the face is the one of the dominant axis
+	const glm::vec3 absolute = glm::abs(cube);
+	uint8_t face;
+	if (absolute.x >= absolute.y and absolute.x >= absolute.z)
+		face = cube.x > 0 ? 1 : 3;
+	else if (absolute.y >= absolute.z)
+		face = cube.y > 0 ? 4 : 5;
+	else
+		face = cube.z > 0 ? 2 : 0;
+
+	//coordinates of the position in the grid of the face, the right and up vectors have a length of 2 like the face
+	const glm::vec3 local = cube - faceOrigins[face];
+	const float u = glm::dot(local, faceRights[face]) * .25f;
+	const float v = glm::dot(local, faceUps[face]) * .25f;
+
+	//NaN components
+	if (!(u == u and v == v))
+		return findInRegions(position);
+
+	const uint32_t last = resolution_ - 1;
+	const uint32_t i = std::min(static_cast<uint32_t>(std::max(u, 0.f) * static_cast<float>(resolution_)), last);
+	const uint32_t j = std::min(static_cast<uint32_t>(std::max(v, 0.f) * static_cast<float>(resolution_)), last);
+	return Index(face, i, j);
+}
+
+ns::Sphere::SphereContainer::Index ns::Sphere::SphereContainer::findInRegions(const glm::vec3& position) const
+{
 	static std::vector<uint8_t> faces(6);
 	faces.clear();
 
@@ -278,6 +417,36 @@ ns::Sphere::SphereContainer::Index ns::Sphere::SphereContainer::find(const glm::
 	return Index::null;
 }
 
+glm::vec3 ns::Sphere::SphereContainer::sphereToCube(const glm::vec3& position)
+{
+	using namespace glm;
+
+	//the axis of the face is at +-1 on the cube, the two others are found by inverting the mapping of genVertexRows():
+	//with a face at z = 1, x^2 = u^2 (1/2 - v^2/6) and y^2 = v^2 (1/2 - u^2/6) so u^2 - v^2 = 2 (x^2 - y^2)
+	//and v^2 is the root in [0, 1] of v^4 + (2 (x^2 - y^2) - 3) v^2 + 6 y^2 = 0
+	const vec3 absolute = abs(position);
+	int axis = 2;
+	if (absolute.x >= absolute.y and absolute.x >= absolute.z) axis = 0;
+	else if (absolute.y >= absolute.z) axis = 1;
+
+	const int a = (axis + 1) % 3;
+	const int b = (axis + 2) % 3;
+
+	const float x2 = position[a] * position[a];
+	const float y2 = position[b] * position[b];
+	const float difference = 2.f * (x2 - y2);
+	const float c = 3.f - difference;
+
+	const float v2 = clamp(.5f * (c - std::sqrt(std::max(c * c - 24.f * y2, 0.f))), 0.f, 1.f);
+	const float u2 = clamp(v2 + difference, 0.f, 1.f);
+
+	vec3 cube;
+	cube[axis] = position[axis] < 0 ? -1.f : 1.f;
+	cube[a] = position[a] < 0 ? -std::sqrt(u2) : std::sqrt(u2);
+	cube[b] = position[b] < 0 ? -std::sqrt(v2) : std::sqrt(v2);
+	return cube;
+}
+
 ns::Sphere::SphereContainer::Index ns::Sphere::SphereContainer::find(const Index& previousIndex, const glm::vec3& normalizedVector) const
 {
 	// TODO : will be easier to implement when the chunk loading system will be done
@@ -285,203 +454,336 @@ ns::Sphere::SphereContainer::Index ns::Sphere::SphereContainer::find(const Index
 	return Index();
 }
 
-bool ns::Sphere::SphereContainer::loadChunk(const Index& index)
+const std::shared_ptr<const ns::IndexBuffer>& ns::Sphere::SphereContainer::chunkIndices(uint8_t coarseSides)
+{
+	auto& indices = chunkIndices_[coarseSides];
+	if (!indices)
+		indices = std::make_shared<const IndexBuffer>(SphereChunk::generateIndices(generator_.settings().chunkResolution, coarseSides));
+	return indices;
+}
+
+std::array<glm::vec3, 4> ns::Sphere::SphereContainer::cubeSquare(const Index& index, uint8_t level)
+{
+	//the coordinates are multiples of a power of two so they are exact
+	const float size = 1.f / static_cast<float>(1U << level);
+	const glm::vec3 right = faceRights[index.face] * size;
+	const glm::vec3 up = faceUps[index.face] * size;
+	const glm::vec3 origin = faceOrigins[index.face] + right * static_cast<float>(index.i) + up * static_cast<float>(index.j);
+
+	return { origin, origin + right, origin + up, origin + right + up };
+}
+
+ns::Sphere::SphereChunk::Cell ns::Sphere::SphereContainer::cubeCell(const Index& index, uint8_t level)
 {
-	if (!isLoaded(index)) {
-		auto& c = chunk(index);
+	SphereChunk::Cell ret;
+	ret.faceOrigin = faceOrigins[index.face];
+	ret.faceRight = faceRights[index.face];
+	ret.faceUp = faceUps[index.face];
+	ret.position = glm::u16vec2(index.i, index.j);
+	ret.level = level;
+	return ret;
+}
+
+void ns::Sphere::SphereContainer::initNode(LodNode& node, const Index& index, uint8_t level) const
+{
+	const auto square = cubeSquare(index, level);
+
+	node.index = index;
+	node.level = level;
+	node.direction = cubeToSphere(.25f * (square[0] + square[1] + square[2] + square[3]));
+	node.halfDiagonal = 0;
+	for (const glm::vec3& corner : square)
+		node.halfDiagonal = std::max(node.halfDiagonal, glm::length(cubeToSphere(corner) - node.direction) * radius_);
+}
+
+void ns::Sphere::SphereContainer::createChildren(LodNode& node) const
+{
+	node.children = std::make_shared<BiArray<LodNode>>(2, 2);
+
+	for (uint16_t y = 0; y < 2; y++)
+	{
+		for (uint16_t x = 0; x < 2; x++)
+		{
+			const Index index(node.index.face, node.index.i * 2 + x, node.index.j * 2 + y);
+			initNode(node.children->value(x, y), index, node.level + 1);
+		}
+	}
+}
+
+ns::Sphere::SphereContainer::LodNode* ns::Sphere::SphereContainer::findNode(const Index& index, uint8_t level)
+{
+	LodNode* node = &roots_[index.face];
+	while (node->level < level)
+	{
+		if (!node->children) return nullptr;
 
-		std::array<glm::vec3, 4> square{
-			vertex(c.coords.a),
-			vertex(c.coords.b),
-			vertex(c.coords.c),
-			vertex(c.coords.d)
-		};
+		//the bit of the coordinates at the level of the children tells which child contains the cell
+		const uint8_t shift = level - node->level - 1;
+		node = &node->children->value((index.i >> shift) & 1, (index.j >> shift) & 1);
+	}
+	return node;
+}
 
-		c.mesh = std::make_shared<SphereChunk>(square, radius_, 20);
-		c.index = index;
-		loadedChunks_.push_back(&c);
-		return true;
+const ns::Sphere::SphereContainer::LodNode& ns::Sphere::SphereContainer::visibleNode(const Index& index, uint8_t level) const
+{
+	const LodNode* node = &roots_[index.face];
+	while (node->level < level and node->split)
+	{
+		const uint8_t shift = level - node->level - 1;
+		node = &node->children->value((index.i >> shift) & 1, (index.j >> shift) & 1);
 	}
-	return false;
+	return *node;
+}
+
+float ns::Sphere::SphereContainer::nodeDistance(const LodNode& node, const glm::vec3& cameraPosition) const
+{
+	return std::max(glm::length(cameraPosition - node.direction * radius_) - node.halfDiagonal, 0.f);
+}
+
+float ns::Sphere::SphereContainer::splitDistance(const LodNode& node) const
+{
+	//a face covers a quarter of a great circle and each triangle edge of a node covers 1 / chunkResolution of it
+	const float edge = .5f * glm::pi<float>() * radius_ / static_cast<float>(1U << node.level) / static_cast<float>(generator_.settings().chunkResolution);
+
+	//the size of the edge on the screen is edge * projectionScale_ / distance,
+	//the minimum of 2.5 half diagonals keeps the neighbours that want to split at most one level apart (restrictNode() also ensures it while the children load)
+	return std::max(edge * projectionScale_ / maximumError_, 2.5f * node.halfDiagonal);
 }
 
-bool ns::Sphere::SphereContainer::unloadChunk(const Index& index)
+void ns::Sphere::SphereContainer::selectNodes(LodNode& node, const glm::vec3& cameraPosition)
 {
-	if (isLoaded(index)) {
-		bool founded = false;
-		for (auto it = loadedChunks_.begin(); it != loadedChunks_.end(); ++it)
+	const float distance = nodeDistance(node, cameraPosition);
+	if (!node.mesh and !node.loading)
+		requestedNodes_.emplace_back(distance, &node);
+
+	const float split = splitDistance(node);
+	if (node.level < maxLevel_ and distance < split) {
+		if (!node.children)
+			createChildren(node);
+
+		//the node stays drawn until its four children are loaded
+		bool ready = true;
+		for (uint8_t i = 0; i < 4; i++)
 		{
-			if (*it == &chunk(index)) {
-				loadedChunks_.erase(it);
-				founded = true;
-				break;
-			}
+			LodNode& child = (*node.children)[i];
+			if (child.mesh) continue;
+
+			ready = false;
+			if (!child.loading)
+				requestedNodes_.emplace_back(nodeDistance(child, cameraPosition), &child);
 		}
-		
-		chunk(index).mesh.reset();
-		return true;
+		node.split = ready;
+	}
+	else {
+		node.split = false;
+		if (distance > split * mergeDistanceFactor)
+			node.children.reset();
+	}
+
+	if (node.split) {
+		for (uint8_t i = 0; i < 4; i++)
+			selectNodes((*node.children)[i], cameraPosition);
 	}
-	return false;
 }
 
-//this create the sphere terrain grid vertices
-void ns::Sphere::SphereContainer::genSphereVertices(SphereContainer* object)
+bool ns::Sphere::SphereContainer::restrictNode(LodNode& node)
 {
-	using namespace glm;
-	static const vec3 origins[NUMBER_OF_FACES_IN_A_CUBE]
+	if (!node.split) return false;
+
+	//the children can only be drawn if the neighbours are at least at the level of the node, otherwise the stitching can't close the border
+	for (uint8_t side = 0; side < 4 and node.level > 0; side++)
 	{
-		vec3(-1.0, -1.0, -1.0),
-		vec3(1.0, -1.0, -1.0),
-		vec3(1.0, -1.0, 1.0),
-		vec3(-1.0, -1.0, 1.0),
-		vec3(-1.0, 1.0, -1.0),
-		vec3(-1.0, -1.0, 1.0)
-	};
-	static const vec3 rights[NUMBER_OF_FACES_IN_A_CUBE]
+		Index neighbour = node.index;
+		neighbour.add(sideOffsets[side], 1U << node.level);
+
+		if (visibleNode(neighbour, node.level).level < node.level) {
+			node.split = false;
+			return true;
+		}
+	}
+
+	bool merged = false;
+	for (uint8_t i = 0; i < 4; i++)
+		merged |= restrictNode((*node.children)[i]);
+	return merged;
+}
+
+void ns::Sphere::SphereContainer::collectNodes(LodNode& node)
+{
+	if (node.split) {
+		for (uint8_t i = 0; i < 4; i++)
+			collectNodes((*node.children)[i]);
+	}
+	else if (node.mesh) {
+		visibleNodes_.push_back(&node);
+	}
+}
+
+void ns::Sphere::SphereContainer::stitchNodes()
+{
+	for (LodNode* node : visibleNodes_)
 	{
-		vec3(2.0, 0.0, 0.0),
-		vec3(0.0, 0.0, 2.0),
-		vec3(-2.0, 0.0, 0.0),
-		vec3(0.0, 0.0, -2.0),
-		vec3(2.0, 0.0, 0.0),
-		vec3(2.0, 0.0, 0.0)
-	};
-	static const vec3 ups[NUMBER_OF_FACES_IN_A_CUBE]
+		//the neighbours are found at the level of the node, on the same face or across an edge of the cube
+		uint8_t coarseSides = 0;
+		for (uint8_t side = 0; side < 4 and node->level > 0; side++)
+		{
+			Index neighbour = node->index;
+			neighbour.add(sideOffsets[side], 1U << node->level);
+
+			if (visibleNode(neighbour, node->level).level < node->level)
+				coarseSides |= 1 << side;
+		}
+
+		if (coarseSides != node->coarseSides) {
+			node->coarseSides = coarseSides;
+			node->mesh->setIndices(chunkIndices(coarseSides));
+		}
+	}
+}
+
+void ns::Sphere::SphereContainer::requestNodes()
+{
+	//the coarse nodes first because they fill the holes, then the closest ones
+	std::sort(requestedNodes_.begin(), requestedNodes_.end(), [](const std::pair<float, LodNode*>& a, const std::pair<float, LodNode*>& b) {
+		if (a.second->level != b.second->level)
+			return a.second->level < b.second->level;
+		return a.first < b.first;
+	});
+
+	for (const auto& [distance, node] : requestedNodes_)
 	{
-		vec3(0.0, 2.0, 0.0),
-		vec3(0.0, 2.0, 0.0),
-		vec3(0.0, 2.0, 0.0),
-		vec3(0.0, 2.0, 0.0),
-		vec3(0.0, 0.0, 2.0),
-		vec3(0.0, 0.0, -2.0)
-	};
-	//not used but may be useful in the futur i don't know
-	static const vec3 normals[NUMBER_OF_FACES_IN_A_CUBE]
+		if (loadingJobs_.pending() >= maxLoadingJobs_) return;
+
+		node->loading = true;
+		const Index index = node->index;
+		const uint8_t level = node->level;
+		const glm::vec3 direction = node->direction;
+		const SphereChunk::Cell cell = cubeCell(index, level);
+
+		//the job only needs a copy of the position of the node, which can be merged before the end of the job
+		JobSystem::get().submit([this, index, level, direction, cell]() {
+			loadedChunksData_.push(LoadedChunk{ index, level, direction, SphereChunk::generateVertices(cell, radius_, generator_) });
+		}, JobSystem::Priority::normal, &loadingJobs_);
+	}
+}
+
+void ns::Sphere::SphereContainer::uploadChunks(const glm::vec3& cameraPosition)
+{
+	loadedChunksData_.consume([this](LoadedChunk& data) { pendingUploads_.emplace_back(std::move(data)); });
+	if (pendingUploads_.empty()) return;
+
+	//the closest nodes are at the end so they are uploaded first
+	std::sort(pendingUploads_.begin(), pendingUploads_.end(), [&](const LoadedChunk& a, const LoadedChunk& b) {
+		return glm::distance(a.direction * radius_, cameraPosition) > glm::distance(b.direction * radius_, cameraPosition);
+	});
+
+	const auto start = std::chrono::steady_clock::now();
+	const std::chrono::duration<float, std::milli> budget(uploadBudget_);
+
+	size_t uploads = 0;
+	while (pendingUploads_.size() and (uploads == 0 or std::chrono::steady_clock::now() - start < budget))
 	{
-		vec3(0.0, 0.0, -1.0),
-		vec3(1.0, 0.0 ,0.0),
-		vec3(0.0, 0.0, 1.0),
-		vec3(-1.0, 0.0, 0.0),
-		vec3(0.0, 1.0 ,0.0),
-		vec3(0.0, -1.0, 0.0)
-	};
+		LoadedChunk& data = pendingUploads_.back();
+
+		//the node may have been merged while it was loading
+		LodNode* node = findNode(data.index, data.level);
+		if (node) {
+			node->loading = false;
+			if (!node->mesh) {
+				node->mesh = std::make_shared<SphereChunk>(data.vertices, chunkIndices(0), radius_, generator_.settings().chunkResolution);
+				node->coarseSides = 0;
+				uploads++;
+			}
+		}
+		pendingUploads_.pop_back();
+	}
+}
 
+//this create the sphere terrain grid vertices
+void ns::Sphere::SphereContainer::genSphereVertices(SphereContainer* object)
+{
 	Timer t("generate spherified cube");
 
-	const float step = 1.f / (float)object->resolution_;
+	JobSystem& jobs = JobSystem::get();
+	JobCounter counter;
 	object->sphereProgression_ = 0;
 
+	//the rows of the faces are independent so each job computes a few rows
 	for (uint8_t face = 0; face < NUMBER_OF_FACES_IN_A_CUBE; face++)
 	{
-		//std::cout << "face " << (int)face << std::endl;
-		for (uint32_t j = 0; j < object->resolutionPlusOne_; j++)
+		for (uint32_t row = 0; row < object->resolutionPlusOne_; row += rowsPerJob)
 		{
-			const glm::vec3 jup = (float)j * ups[face];
-
-			for (uint32_t i = 0; i < object->resolutionPlusOne_; i++)
-			{
-				const glm::vec3 p = origins[face] + step * ((float)i * rights[face] + jup);
-				const glm::vec3 p2 = p * p;
-				const glm::vec3 n(
-					p.x * std::sqrt(1.0f - 0.5f * (p2.y + p2.z) + p2.y * p2.z / 3.0f),
-					p.y * std::sqrt(1.0f - 0.5f * (p2.z + p2.x) + p2.z * p2.x / 3.0f),
-					p.z * std::sqrt(1.0f - 0.5f * (p2.x + p2.y) + p2.x * p2.y / 3.0f)
-				);
-
-				object->vertices_[face].emplace(i, j, { n * object->radius_ });
-				object->sphereProgression_++;
-			}
-			//std::cout << object->sphereProgressionPercentage() << " %" << newl;
+			const uint32_t lastRow = std::min(row + rowsPerJob, object->resolutionPlusOne_);
+			jobs.submit([=]() { object->genVertexRows(face, row, lastRow); }, JobSystem::Priority::normal, &counter);
 		}
 	}
+	jobs.wait(counter);
 
-	const uint32_t k = object->resolutionPlusOne_;
-	for (uint32_t face = 0; face < NUMBER_OF_FACES_IN_A_CUBE; ++face)
+	//the limits of a chunk use the vertices of the next row so they wait for all the vertices
+	for (uint8_t face = 0; face < NUMBER_OF_FACES_IN_A_CUBE; face++)
 	{
-		for (uint32_t j = 0; j < object->resolution_; ++j)
+		for (uint32_t row = 0; row < object->resolution_; row += rowsPerJob)
 		{
-			for (uint32_t i = 0; i < object->resolution_; ++i)
-			{
-				auto& const value = object->terrain_[face].value(i, j);
-				value.coords.a.face = face;
-				value.coords.a.i = i;
-				value.coords.a.j = j;
-			
-				value.coords.b.face = face;
-				value.coords.b.i = i + 1;
-				value.coords.b.j = j;
-				
-				value.coords.c.face = face;
-				value.coords.c.i = i;
-				value.coords.c.j = j + 1;
-				
-				value.coords.d.face = face;
-				value.coords.d.i = i + 1;
-				value.coords.d.j = j + 1;
-
-				object->fillChunkLimits(value.limit, value.coords);
-				//object->loadChunk(Index(face, i, j));
-			}
+			const uint32_t lastRow = std::min(row + rowsPerJob, object->resolution_);
+			jobs.submit([=]() { object->genChunkRows(face, row, lastRow); }, JobSystem::Priority::normal, &counter);
 		}
 	}
+	jobs.wait(counter);
 
 	for (uint8_t face = 0; face < NUMBER_OF_FACES_IN_A_CUBE; ++face) {
-		//init first sub-region
-		auto& region = object->subRegions[face];
+		jobs.submit([=]() {
+			//init first sub-region
+			auto& region = object->subRegions[face];
 
-		region.firstChunkIndex = glm::u16vec2(0);
-		region.lastChunkIndex = glm::u16vec2(object->resolution_ - 1);
+			region.firstChunkIndex = glm::u16vec2(0);
+			region.lastChunkIndex = glm::u16vec2(object->resolution_ - 1);
 
-		//recursively create all the sub-regions
-		object->fillChunkSubRegions(region, face);
-		//logRegion(region);
+			//recursively create all the sub-regions
+			object->fillChunkSubRegions(region, face);
+		}, JobSystem::Priority::normal, &counter);
 	}
+	jobs.wait(counter);
+
+	object->ready_ = true;
 }
 
-std::array<std::vector<glm::ivec2>, ns::maximunRenderDistance> ns::Sphere::SphereContainer::getOrder()
+void ns::Sphere::SphereContainer::genVertexRows(uint8_t face, uint32_t firstRow, uint32_t lastRow)
 {
-	//(dst, dst) / (-1, 0) * dst * 2 / (0, -1) * dst * 2 / (1, 0) * dst * 2 / (0, 1) * (dst * 2 - 1)
-	std::array<std::vector<glm::ivec2>, maximunRenderDistance> ret;
+	const float step = 1.f / (float)resolution_;
+	glm::vec3* row = vertices_[face].data() + (size_t)firstRow * resolutionPlusOne_;
 
-	//central chunk offset is of course null
-	ret[0].push_back(glm::ivec2(0, 0));
-
-	for (size_t dst = 1; dst < maximunRenderDistance; dst++)
+	for (uint32_t j = firstRow; j < lastRow; j++, row += resolutionPlusOne_)
 	{
-		std::vector<glm::ivec2>& circle = ret[dst];
-		circle.resize(8 * dst);
-
-		//start by the chunk that is at ivec2(dst - 1, dst)
-		circle[0] = glm::ivec2(dst - 1, dst);
-		unsigned cursor = 1;
+		const glm::vec3 jup = (float)j * faceUps[face];
 
-		//then go to the top-left corner
-		for (size_t i = 0; i < dst * 2 - 1; i++)
+		//the iterations are independent and write a contiguous row so the compiler can vectorize the loop
+		for (uint32_t i = 0; i < resolutionPlusOne_; i++)
 		{
-			circle[cursor] = circle[cursor - 1] + glm::ivec2(-1, 0);
-			cursor++;
+			const glm::vec3 p = faceOrigins[face] + step * ((float)i * faceRights[face] + jup);
+			row[i] = cubeToSphere(p) * radius_;
 		}
-		//then to the bottom-left corner
-		for (size_t i = 0; i < dst * 2; i++)
-		{
-			circle[cursor] = circle[cursor - 1] + glm::ivec2(0, -1);
-			cursor++;
-		}
-		//then to the bottom-right corner
-		for (size_t i = 0; i < dst * 2; i++)
-		{
-			circle[cursor] = circle[cursor - 1] + glm::ivec2(1, 0);
-			cursor++;
-		}
-		//then just under the start at ivec2(dst, dst - 1)
-		for (size_t i = 0; i < dst * 2; i++)
+	}
+
+	sphereProgression_ += (uint64_t)(lastRow - firstRow) * resolutionPlusOne_;
+}
+
+void ns::Sphere::SphereContainer::genChunkRows(uint8_t face, uint32_t firstRow, uint32_t lastRow)
+{
+	for (uint32_t j = firstRow; j < lastRow; ++j)
+	{
+		for (uint32_t i = 0; i < resolution_; ++i)
 		{
-			circle[cursor] = circle[cursor - 1] + glm::ivec2(0, 1);
-			cursor++;
+			Chunk& value = terrain_[face].value(i, j);
+			value.coords.a = Index(face, i, j);
+			value.coords.b = Index(face, i + 1, j);
+			value.coords.c = Index(face, i, j + 1);
+			value.coords.d = Index(face, i + 1, j + 1);
+
+			fillChunkLimits(value.limit, value.coords);
 		}
-		//and all the chunks in the square that has a size of dst * 2 + 1 are in the array at the index dst
 	}
-	return ret;
+
+	sphereProgression_ += (uint64_t)(lastRow - firstRow) * resolution_;
 }
 
 void ns::Sphere::SphereContainer::Index::add(glm::ivec2 offset, uint32_t resolution, uint8_t itCount)
@@ -3,6 +3,8 @@
 //ns
 #include <Utils/BiArray.h>
 #include <Utils/DebugLayer.h>
+#include <Utils/JobSystem.h>
+#include <Utils/MpscQueue.h>
 #include "SphereChunk.h"
 #include "Sphere.h"
 #include <Rendering/Mesh.h>
@@ -15,16 +17,27 @@ namespace ns::Sphere {
 	{
 	public:
 		/**
-		 * @brief create the sphere container
-		 * \param resolution
+		 * @brief create the sphere container, the grid is generated by the jobs of the job system
+		 * \param resolution number of chunks on each side of a face of the grid, the deepest level of detail has about the same size
 		 * \param sphereRadius
+		 * \param generation settings of the terrain of the chunks
+		 * \param async when true the constructor returns immediately and the grid is generated in the background, see isReady()
 		 */
-		SphereContainer(uint32_t resolution, float sphereRadius);
+		SphereContainer(uint32_t resolution, float sphereRadius, const PlanetGenerator::Settings& generation = PlanetGenerator::defaultSettings(), bool async = false);
+		/**
+		 * @brief wait for the end of the grid generation and of the chunks loading
+		 */
+		~SphereContainer();
 		/**
 		 * @brief return the progression of the sphere creation
 		 * \return 
 		 */
 		double sphereProgressionPercentage() const;
+		/**
+		 * @brief allow to know if the grid generation is finished, findChunk() and getDebugSphere() need it
+		 * \return 
+		 */
+		bool isReady() const;
 		/**
 		 * @brief return a mesh that render the chunk grid of the sphere 
 		 * \return 
@@ -33,7 +46,7 @@ namespace ns::Sphere {
 		/**
 		 * @brief input a position relative to the sphere and normalized
 		 * \param normalizedVector
-		 * \return
+		 * \return the mesh drawn at this position (it can be the one of a coarse node) or nothing if it isn't loaded
 		 */
 		std::shared_ptr<SphereChunk> findChunk(const glm::vec3& normalizedVector);
 		/**
@@ -41,34 +54,43 @@ namespace ns::Sphere {
 		 * \return 
 		 */
 		float radius() const;
+		/**
+		 * @brief return the generator of the terrain of the chunks
+		 * \return
+		 */
+		const PlanetGenerator& generator() const;
 
-		void update(const glm::vec3& direction);
-
-		void DEBUG_showOrigin() {
-			
-			for (size_t i = 1; i < NUMBER_OF_FACES_IN_A_CUBE + 1; i++)
-			{
-				for (size_t x = 0; x < i; x++)
-				{
-					if (loadChunk(Index(i - 1, x, 0))) return;
-				}
-				loadChunk(Index(i - 1, i + 1, 0));
-			}
-		}
-
-		void clear() {
-			for (size_t i = 0; i < loadedChunks_.size(); i++)
-			{
-				if (unloadChunk(loadedChunks_[i]->index)) return;
-			}
-		}
+		/**
+		 * @brief select the nodes of the quadtrees of the faces that are drawn from a camera position:
+		 * a node is split in four when its triangles are too big on the screen, it is drawn until its four children are loaded on the job system,
+		 * then the loaded meshes are uploaded within the budget and the borders of the nodes next to coarser ones are stitched
+		 * \param cameraPosition position of the camera relative to the center of the sphere
+		 */
+		void update(const glm::vec3& cameraPosition);
+		/**
+		 * @brief set the parameters of the screen-space error of the level of detail
+		 * \param fov vertical field of view of the camera in radians
+		 * \param screenHeight height of the screen in pixels
+		 * \param maximumError a node is split when the edges of its triangles are longer than this number of pixels on the screen
+		 */
+		void setLodSettings(float fov, float screenHeight, float maximumError);
+		/**
+		 * @brief set the maximum time spent each frame to create the meshes of the loaded nodes (at least one is created each frame)
+		 * \param milliseconds
+		 */
+		void setUploadBudget(float milliseconds);
+		/**
+		 * \return the maximum time spent each frame to create the meshes of the loaded nodes in milliseconds
+		 */
+		float uploadBudget() const;
+		/**
+		 * @brief release the meshes of all the nodes, they are loaded again by the next updates
+		 */
+		void clear();
 
 		virtual void draw(const ns::Shader& shader) const override;
 		
 
-		static std::array<std::vector<glm::ivec2>, ns::maximunRenderDistance> getOrder();
-		static std::array<std::vector<glm::ivec2>, ns::maximunRenderDistance> loadingOrder;
-
 		friend class SphereChunk;
 	protected:
 
@@ -115,10 +137,29 @@ namespace ns::Sphere {
 
 		//describe a chunk
 		struct Chunk {
-			std::shared_ptr<SphereChunk> mesh;//mesh of the chunk
 			ChunkCoords coords{};//position of the chunk
 			ChunkLimits limit{};//limits of the chunk
-			Index index;	//allow to find chunk in the memory 
+		};
+
+		//node of the quadtree of a face, like a ChunksRegion but on a grid of 2^level * 2^level cells whatever the resolution
+		struct LodNode {
+			Index index;			//face and position in the grid of its level
+			uint8_t level = 0;		//depth in the quadtree
+			glm::vec3 direction{};	//normalized direction of the center of the node
+			float halfDiagonal = 0;	//largest distance between the center and a corner on the sphere
+			std::shared_ptr<SphereChunk> mesh;
+			uint8_t coarseSides = 0;//SphereChunk::Side bits of the index buffer of the mesh
+			bool loading = false;	//a job is computing the vertices of the node
+			bool split = false;		//the children are drawn instead of the node
+			std::shared_ptr<ns::BiArray<LodNode>> children;//array of four nodes of the next level or nothing
+		};
+
+		//vertices of a node computed by a job, waiting for the creation of the mesh
+		struct LoadedChunk {
+			Index index;
+			uint8_t level;
+			glm::vec3 direction;
+			std::vector<Vertex> vertices;
 		};
 
 	protected:
@@ -126,17 +167,33 @@ namespace ns::Sphere {
 		const uint32_t resolution_;
 		const uint32_t resolutionPlusOne_;
 		const float radius_;
+		const PlanetGenerator generator_;
 
 		//data
 		std::array<ns::BiArray<Chunk>, NUMBER_OF_FACES_IN_A_CUBE> terrain_; //terrain
 		std::array<ns::BiArray<glm::vec3>, NUMBER_OF_FACES_IN_A_CUBE> vertices_;//spheric grid vertices 
 		std::array<ChunksRegion, NUMBER_OF_FACES_IN_A_CUBE> subRegions;	//sub regions of the chunk that allow to quickly search for a chunk
-		std::vector<Chunk*> loadedChunks_;		//pointers of the chunks that are loaded
-		Index centralChunk_;
 		
 		//multi-threading
 		std::thread sphereThread_;
-		std::atomic_uint32_t sphereProgression_;
+		std::atomic_uint64_t sphereProgression_;	//number of vertices and chunks of the grid that are generated
+		std::atomic_bool ready_;
+
+		//level of detail
+		std::array<LodNode, NUMBER_OF_FACES_IN_A_CUBE> roots_;	//quadtree of each face
+		std::vector<LodNode*> visibleNodes_;	//nodes drawn since the last update
+		std::vector<std::pair<float, LodNode*>> requestedNodes_;//nodes without mesh needed by the last update and their distance to the camera
+		uint8_t maxLevel_;
+		float projectionScale_;					//size in pixels of one unit of length at a distance of one
+		float maximumError_;					//in pixels
+
+		//chunks loading
+		unsigned maxLoadingJobs_;				//the jobs are not cancellable so only a few are queued at once
+		float uploadBudget_;					//in milliseconds
+		JobCounter loadingJobs_;
+		MpscQueue<LoadedChunk> loadedChunksData_;//filled by the jobs, consumed by update()
+		std::vector<LoadedChunk> pendingUploads_;//loaded chunks that didn't fit in the budget of the previous frames
+		std::array<std::shared_ptr<const IndexBuffer>, 16> chunkIndices_;//triangles of the chunks for each combination of stitched sides
 
 	protected:
 		bool checkCoordIsInLimit(const glm::vec3& pos, const ChunkLimits& limit) const;//allow to know if a position is in a chunk
@@ -151,14 +208,32 @@ namespace ns::Sphere {
 		const Chunk& chunk(const Index& index) const;//get a chunk of the terrain
 		Chunk& chunk(const Index& index);//get a chunk of the terrain
 		
-		Index find(const glm::vec3& normalizedVector) const;//find a chunk index with the normalized position relative to the sphere
+		Index find(const glm::vec3& normalizedVector) const;//find a chunk index with the normalized position relative to the sphere in constant time
+		Index findInRegions(const glm::vec3& normalizedVector) const;//find a chunk index by searching in the sub-regions (slow, only used when find() fails)
+		static glm::vec3 sphereToCube(const glm::vec3& normalizedVector);//inverse of the spherified cube mapping, return a position on the cube [-1, 1]^3
 		Index find(const Index& previousIndex, const glm::vec3& normalizedVector) const;//find a chunk index by searching around the previous chunk
 
-		bool isLoaded(const Index& chunk) const;//allow to know if a chunk is loaded 
-		bool loadChunk(const Index& chunk);
-		bool unloadChunk(const Index& chunk);
+		const std::shared_ptr<const IndexBuffer>& chunkIndices(uint8_t coarseSides);//return an index buffer of the chunks and create it if it doesn't exist (opengl thread only)
+
+		static std::array<glm::vec3, 4> cubeSquare(const Index& index, uint8_t level);//corners of a cell of the grid of a level on the cube
+		static SphereChunk::Cell cubeCell(const Index& index, uint8_t level);//cell of the grid of a level, to generate the vertices of its chunk
+		void initNode(LodNode& node, const Index& index, uint8_t level) const;//compute the position of a node
+		void createChildren(LodNode& node) const;
+		LodNode* findNode(const Index& index, uint8_t level);//return the node of a cell or nullptr if the quadtree doesn't go so deep there
+		const LodNode& visibleNode(const Index& index, uint8_t level) const;//return the drawn node that contains a cell (or the deepest existing one)
+		float nodeDistance(const LodNode& node, const glm::vec3& cameraPosition) const;//distance between the camera and the bounding sphere of a node
+		float splitDistance(const LodNode& node) const;//a node is split when the camera is closer than this distance
+
+		void selectNodes(LodNode& node, const glm::vec3& cameraPosition);//split the nodes of a quadtree that are close enough and fill requestedNodes_
+		bool restrictNode(LodNode& node);//merge the split nodes next to a coarser region so neighbours stay at most one level apart, return true if a node was merged
+		void collectNodes(LodNode& node);//fill visibleNodes_ with the drawn nodes of a quadtree
+		void stitchNodes();//change the triangles of the visible nodes next to coarser ones
+		void requestNodes();//queue the loading jobs of the requested nodes, the coarse ones first
+		void uploadChunks(const glm::vec3& cameraPosition);//create the meshes of the loaded nodes, the closest first
 
 		static void genSphereVertices(SphereContainer* object);//create the grid in the object (multi-threadable function)
+		void genVertexRows(uint8_t face, uint32_t firstRow, uint32_t lastRow);//compute the vertices of the rows [firstRow, lastRow[ of a face
+		void genChunkRows(uint8_t face, uint32_t firstRow, uint32_t lastRow);//fill the coordinates and the limits of the chunks of the rows [firstRow, lastRow[ of a face
 
 		static void logRegion(const ChunksRegion& region){
 			dout << "\nstart :\nfirst = " << to_string((glm::ivec2)region.firstChunkIndex) <<
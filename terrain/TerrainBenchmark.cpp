@@ -0,0 +1,245 @@
+#include "TerrainBenchmark.h"
+#include "Plane/FlatTerrainScene.h"
+#include "Plane/StaticHeightMapGenerator.h"
+
+//stl
+#include <chrono>
+#include <thread>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+//peak memory
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+namespace {
+	//terrain that records the loaded chunks instead of creating their meshes, so it doesn't need an opengl context
+	//(its settings don't come from the configuration file and are not saved in it)
+	class HeadlessTerrainScene : public ns::Plane::FlatTerrainScene
+	{
+	public:
+		HeadlessTerrainScene(const ns::TerrainBenchmarkSettings& benchmark, unsigned threads, const ns::Plane::HeightMapGenerator& function)
+			:
+			FlatTerrainScene(Settings(benchmark.chunkPhysicalSize, benchmark.numberOfPartitions), function, loadingSettings(benchmark, threads))
+		{}
+
+		//load the chunks around the camera like update(camera) does
+		void follow(const ns::MapLengthType& position, const ns::MapLengthType& direction, const ns::MapLengthType& chunkSize)
+		{
+			const float length = glm::length(direction);
+			const Viewpoint viewpoint{ position, (length > 0) ? direction / length : ns::MapLengthType(0), cameraFov };
+			update(ns::GridPositionType(glm::floor(position / chunkSize)), viewpoint);
+		}
+
+		std::vector<float> loadingTimes;	//time spent by the loading jobs in milliseconds
+		std::vector<float> latencies;		//time between the request and the upload of the chunks in milliseconds
+		size_t generatedChunks = 0;			//chunks whose heights were generated (the others only rebuilt their mesh)
+
+	protected:
+		//default fov of the cameras
+		static constexpr float cameraFov = glm::pi<float>() * .4f;
+
+		static LoadingSettings loadingSettings(const ns::TerrainBenchmarkSettings& benchmark, unsigned threads)
+		{
+			LoadingSettings ret;
+			ret.renderDistance = benchmark.renderDistance;
+			ret.levelOfDetailDistance = benchmark.levelOfDetailDistance;
+			ret.maxLoadingThreads = static_cast<uint16_t>(threads);
+			ret.uploadBudget = 1000.f;	//every loaded chunk is recorded in the frame it arrives
+			return ret;
+		}
+
+		void createMesh(Chunk& chunk, ChunkToCreate& data) override
+		{
+			loadingTimes.push_back(data.loadingTime);
+			if (!data.remeshed) generatedChunks++;
+			latencies.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - data.requestTime).count());
+		}
+	};
+}
+
+ns::TerrainBenchmark::TerrainBenchmark(const TerrainBenchmarkSettings& settings, const Plane::HeightMapGenerator& generator)
+	:
+	settings_(settings),
+	generator_(generator)
+{}
+
+int ns::TerrainBenchmark::run()
+{
+	const std::string json = toJson(settings_, measure());
+
+	if (settings_.outputFile.empty()) {
+		std::cout << json;
+		return EXIT_SUCCESS;
+	}
+
+	std::ofstream file(settings_.outputFile);
+	if (!file) return EXIT_FAILURE;
+	file << json;
+
+	return file ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+ns::TerrainBenchmark::Report ns::TerrainBenchmark::measure()
+{
+	using clock = std::chrono::steady_clock;
+	Report ret;
+
+	const unsigned threads = settings_.numberOfThreads ? settings_.numberOfThreads : std::max(std::thread::hardware_concurrency(), 1U);
+
+	Plane::HeightMapGenerator generator(generator_);
+#	if NS_TERRAIN_STATISTICS
+	generator.resetStatistics();
+#	endif // NS_TERRAIN_STATISTICS
+
+	//the scene starts loading in its constructor, so it is measured from there
+	std::vector<float> updateTimes;
+	const auto start = clock::now();
+	HeadlessTerrainScene scene(settings_, threads, generator);
+
+	for (unsigned frame = 0; frame * settings_.frameTime < settings_.duration; frame++)
+	{
+		//the camera moves in real time so the loading threads have the same time as in the application
+		const float time = frame * settings_.frameTime;
+		std::this_thread::sleep_until(start + std::chrono::duration_cast<clock::duration>(std::chrono::duration<float>(time)));
+
+		const MapLengthType position = cameraPosition(time);
+		const MapLengthType direction = cameraPosition(time + settings_.frameTime) - position;
+
+		const auto updateStart = clock::now();
+		scene.follow(position, direction, settings_.chunkPhysicalSize);
+		updateTimes.push_back(std::chrono::duration<float, std::milli>(clock::now() - updateStart).count());
+	}
+
+	ret.seconds = std::chrono::duration<double>(clock::now() - start).count();
+	ret.chunks = scene.loadingTimes.size();
+
+#	if NS_TERRAIN_STATISTICS
+	ret.samples = generator.statistics().samples;
+#	else
+	//without the statistics the samples of the chunks are counted (the cached borders are counted twice)
+	ret.samples = scene.generatedChunks * ((uint64_t)settings_.numberOfPartitions.x + 1) * ((uint64_t)settings_.numberOfPartitions.y + 1);
+#	endif // NS_TERRAIN_STATISTICS
+
+	ret.chunksPerSecond = ret.chunks / ret.seconds;
+	ret.samplesPerSecond = ret.samples / ret.seconds;
+
+	const double busy = std::accumulate(scene.loadingTimes.begin(), scene.loadingTimes.end(), 0.0) * 1e-3;
+	const unsigned workers = std::min(threads, JobSystem::get().numberOfThreads());
+	ret.threadUtilization = busy / (ret.seconds * workers);
+
+	ret.latencyP50 = percentile(scene.latencies, .5);
+	ret.latencyP99 = percentile(scene.latencies, .99);
+	ret.loadingP50 = percentile(scene.loadingTimes, .5);
+	ret.loadingP99 = percentile(scene.loadingTimes, .99);
+	ret.updateP50 = percentile(updateTimes, .5);
+	ret.updateP99 = percentile(updateTimes, .99);
+
+	ret.peakMemory = peakResidentMemory();
+
+	return ret;
+}
+
+std::string ns::TerrainBenchmark::toJson(const TerrainBenchmarkSettings& settings, const Report& report)
+{
+	static const char* paths[] = { "still", "line", "circle", "zigzag" };
+
+	std::ostringstream json;
+	json << "{\n"
+		<< "\t\"settings\": {\n"
+		<< "\t\t\"partitions\": [" << settings.numberOfPartitions.x << ", " << settings.numberOfPartitions.y << "],\n"
+		<< "\t\t\"chunkSize\": [" << settings.chunkPhysicalSize.x << ", " << settings.chunkPhysicalSize.y << "],\n"
+		<< "\t\t\"renderDistance\": " << settings.renderDistance << ",\n"
+		<< "\t\t\"lodDistance\": " << settings.levelOfDetailDistance << ",\n"
+		<< "\t\t\"threads\": " << settings.numberOfThreads << ",\n"
+		<< "\t\t\"path\": \"" << paths[static_cast<int>(settings.path)] << "\",\n"
+		<< "\t\t\"speed\": " << settings.speed << ",\n"
+		<< "\t\t\"duration\": " << settings.duration << "\n"
+		<< "\t},\n"
+		<< "\t\"chunks\": " << report.chunks << ",\n"
+		<< "\t\"samples\": " << report.samples << ",\n"
+		<< "\t\"seconds\": " << report.seconds << ",\n"
+		<< "\t\"chunksPerSecond\": " << report.chunksPerSecond << ",\n"
+		<< "\t\"samplesPerSecond\": " << report.samplesPerSecond << ",\n"
+		<< "\t\"chunkLatencyMs\": { \"p50\": " << report.latencyP50 << ", \"p99\": " << report.latencyP99 << " },\n"
+		<< "\t\"loadingMs\": { \"p50\": " << report.loadingP50 << ", \"p99\": " << report.loadingP99 << " },\n"
+		<< "\t\"updateMs\": { \"p50\": " << report.updateP50 << ", \"p99\": " << report.updateP99 << " },\n"
+		<< "\t\"threadUtilization\": " << report.threadUtilization << ",\n"
+		<< "\t\"peakMemoryBytes\": " << report.peakMemory << "\n"
+		<< "}\n";
+
+	return json.str();
+}
+
+ns::Plane::HeightMapGenerator ns::TerrainBenchmark::defaultGenerator()
+{
+	return Plane::StaticHeightMapGenerator<1, false, false>({ {
+		{.05,  5, 5.5, false},
+		{.2,  20, -.6, false},
+	} });
+}
+
+ns::MapLengthType ns::TerrainBenchmark::cameraPosition(float time) const
+{
+	const float distance = settings_.speed * time;
+
+	switch (settings_.path)
+	{
+	case TerrainBenchmarkSettings::Path::line:
+		return MapLengthType(distance, 0);
+
+	case TerrainBenchmarkSettings::Path::circle: {
+		//the circle starts at the origin and is completed at the end of the benchmark
+		const float radius = std::max(settings_.speed * settings_.duration / (2 * glm::pi<float>()), 1.f);
+		const float angle = distance / radius;
+		return radius * MapLengthType(std::sin(angle), 1 - std::cos(angle));
+	}
+
+	case TerrainBenchmarkSettings::Path::zigzag: {
+		//the segments alternate between x and y
+		const float length = 8 * settings_.chunkPhysicalSize.x;
+		const unsigned segment = static_cast<unsigned>(distance / length);
+		const float remaining = distance - segment * length;
+
+		MapLengthType ret(((segment + 1) / 2) * length, (segment / 2) * length);
+		if (segment % 2) ret.y += remaining;
+		else ret.x += remaining;
+		return ret;
+	}
+
+	default:
+		return MapLengthType(0);
+	}
+}
+
+double ns::TerrainBenchmark::percentile(std::vector<float>& values, double ratio)
+{
+	if (values.empty()) return 0;
+
+	const size_t index = std::min(static_cast<size_t>(ratio * values.size()), values.size() - 1);
+	std::nth_element(values.begin(), values.begin() + index, values.end());
+	return values[index];
+}
+
+uint64_t ns::TerrainBenchmark::peakResidentMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters;
+	if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.PeakWorkingSetSize;
+	return 0;
+#else
+	rusage usage;
+	getrusage(RUSAGE_SELF, &usage);
+	return static_cast<uint64_t>(usage.ru_maxrss) * 1024;	//in kilobytes on linux
+#endif
+}
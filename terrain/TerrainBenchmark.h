@@ -0,0 +1,82 @@
+#pragma once
+//noisy
+#include <configNoisy.hpp>
+#include "Plane/HeightMapGenerator.h"
+
+//stl
+#include <string>
+#include <vector>
+
+namespace ns {
+
+	struct TerrainBenchmarkSettings {
+		enum class Path {
+			still,		//the camera doesn't move
+			line,		//straight line along x
+			circle,		//circle of radius speed * duration / (2 pi) around the origin
+			zigzag		//line along x that turn by 90 degrees every 8 chunks
+		};
+
+		ChunkPartitionType numberOfPartitions = ns::defaultSize;
+		MapLengthType chunkPhysicalSize = MapLengthType(ns::defaultSize);
+		uint16_t renderDistance = 8;
+		uint16_t levelOfDetailDistance = 4;
+		unsigned numberOfThreads = 0;			//maximum number of chunks loading at the same time (0 for the number of hardware threads)
+		Path path = Path::line;
+		float speed = 64;						//camera speed in units per second
+		float duration = 10;					//in seconds
+		float frameTime = 1.f / 60.f;			//time between two updates of the terrain in seconds
+		std::string outputFile;					//the report is written in this file (the standard output if it is empty)
+	};
+
+	/**
+	 * @brief stream a flat terrain along a scripted camera path without window and without opengl, to measure the throughput
+	 * of the heightmap generation and of the meshing. The meshes are dropped instead of being uploaded.
+	 * The report is written in json so it can be compared between two versions.
+	 */
+	class TerrainBenchmark
+	{
+	public:
+		struct Report {
+			uint64_t chunks = 0;			//chunks loaded and meshed
+			uint64_t samples = 0;			//heights computed
+			double seconds = 0;
+			double chunksPerSecond = 0;
+			double samplesPerSecond = 0;
+			double latencyP50 = 0;			//time between the request and the upload of a chunk in milliseconds
+			double latencyP99 = 0;
+			double loadingP50 = 0;			//time spent by a loading job in milliseconds
+			double loadingP99 = 0;
+			double updateP50 = 0;			//time spent in FlatTerrainScene::update() per frame in milliseconds
+			double updateP99 = 0;
+			double threadUtilization = 0;	//time spent loading chunks divided by the time available on the loading threads
+			uint64_t peakMemory = 0;		//peak resident memory of the process in bytes
+		};
+
+		TerrainBenchmark(const TerrainBenchmarkSettings& settings = TerrainBenchmarkSettings(),
+			const Plane::HeightMapGenerator& generator = defaultGenerator());
+		/**
+		 * @brief run the benchmark and write the report
+		 * \return EXIT_SUCCESS or EXIT_FAILURE if the report can't be written
+		 */
+		int run();
+		/**
+		 * @brief run the benchmark and return the report
+		 */
+		Report measure();
+
+		static std::string toJson(const TerrainBenchmarkSettings& settings, const Report& report);
+		//octaves used by the generator interface, their number and their flags are fixed at compile time
+		static Plane::HeightMapGenerator defaultGenerator();
+
+	protected:
+		const TerrainBenchmarkSettings settings_;
+		const Plane::HeightMapGenerator generator_;
+
+	protected:
+		//position of the camera on the map plane after some time
+		MapLengthType cameraPosition(float time) const;
+		static double percentile(std::vector<float>& values, double ratio);
+		static uint64_t peakResidentMemory();
+	};
+}